@@ -0,0 +1,195 @@
+#ifndef ANYTIMEALG
+#define ANYTIMEALG
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "types.h"
+#include "cp.cpp"
+#include "feas.cpp"
+#include "opt.cpp"
+
+//#define ANYTIMEDEBUG
+
+#ifdef ANYTIMEDEBUG
+#include <iostream>
+#endif
+
+// State of an anytime optimization after each probe of the binary search.
+struct AnytimeProgress {
+    int probes; //probes run so far
+    int probed_c; //clock period of the last probe
+    bool feasible; //a retiming was found for probed_c
+    int lower; //lowest clock period not ruled out yet
+    int upper; //clock period of the best retiming found so far
+};
+
+struct AnytimeOptions {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    std::atomic<bool> *cancel = nullptr; //stops the optimization when set to true
+    std::function<void(const AnytimeProgress &)> progress; //called after each probe
+};
+
+struct AnytimeResult {
+    bool r; //retiming found (better than the original clock period)
+    bool complete; //the search finished, c is optimal
+    int c; //clock period of the best retiming found, upper bound of the optimal one
+    int lower; //lower bound of the optimal clock period
+    Graph graph; //retimed graph, always legal
+};
+
+/**
+ * Binary search shared by the anytime versions of OPT1 and OPT2.
+ * Starts from the original graph (r = 0, clock period given by CP) as the best retiming.
+ * Before each probe the deadline and the cancellation token are checked, so a call returns at most one probe after either.
+ * probe(current_c, r) returns the clock period reached (<= current_c) if a retiming was found into r, -1 otherwise.
+ */
+AnytimeResult opt_anytime(Graph &graph, WDEntry *WD, AnytimeOptions &options, std::function<int(int, int *)> probe) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    int *r = (int *) malloc(sizeof(int) * vertex_count); //retiming of the best c
+    int *tmp_r = (int *) malloc(sizeof(int) * vertex_count); //retiming of the current probe
+    for (int i = 0; i < vertex_count; ++i) {
+        r[i] = 0;
+    }
+
+    //The original graph is the first legal retiming
+    int c = cp(graph, tmp_r);
+    int initial_c = c;
+    for (int i = 0; i < vertex_count; ++i) {
+        tmp_r[i] = 0;
+    }
+
+    //No retiming can go below the maximum cycle ratio
+    int c_count;
+    int *c_candidates = get_c_candidates(graph, WD, &c_count, period_lower_bound(graph));
+
+    //Only candidates below the original clock period are worth probing
+    int bot = 0;
+    int top = c_count-1;
+    while(top >= 0 && c_candidates[top] >= c) {
+        --top;
+    }
+
+    AnytimeProgress progress = {0, -1, false, bot <= top ? c_candidates[bot] : c, c};
+    bool complete = true;
+    while(bot <= top) {
+        if((options.cancel && options.cancel->load()) || std::chrono::steady_clock::now() >= options.deadline) {
+            complete = false;
+            break;
+        }
+
+        int b = (top + bot)/2;
+        int current_c = c_candidates[b];
+
+#ifdef ANYTIMEDEBUG
+        printf("[Binary search] b: %d\tbot: %d\ttop: %d\tcc = %d\n", b, bot, top, current_c);
+#endif
+
+        int probe_c = probe(current_c, tmp_r);
+        if(probe_c >= 0) {
+            //the probe may reach a lower c than the targeted one, continue the search from there
+            while(b > bot && c_candidates[b-1] >= probe_c) {
+                --b;
+            }
+            top = b - 1;
+            c = probe_c;
+
+            int *aux_r = r;
+            r = tmp_r;
+            tmp_r = aux_r;
+        } else {
+            bot = b + 1;
+        }
+
+        ++progress.probes;
+        progress.probed_c = current_c;
+        progress.feasible = probe_c >= 0;
+        progress.lower = bot <= top ? c_candidates[bot] : c;
+        progress.upper = c;
+        if(options.progress) options.progress(progress);
+    }
+
+    int lower = bot <= top ? c_candidates[bot] : c;
+
+    //Build retimed graph: wr(e) = w(e) + r(v) - r(u)
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        retimed_edges[i] = Edge(from, to, edges[i].weight + r[to] - r[from]);
+    }
+    Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int i = 0; i < vertex_count; ++i) {
+        retimed_vertices[i] = Vertex(r[i]);
+    }
+
+    free(c_candidates);
+    free(tmp_r);
+    free(r);
+
+    return { c < initial_c, complete, c, lower, Graph(retimed_vertices, retimed_edges, vertex_count, edge_count) };
+}
+
+/**
+ * Anytime OPT1 ALGORITHM
+ * Same binary search as opt1, bounded by options.deadline and options.cancel.
+ * Each probe solves the 7.1 and 7.2 constraints with bellman.
+ * Returns an AnytimeResult with the best retiming found and the remaining bounds of the optimal clock period.
+ */
+AnytimeResult opt1_anytime(Graph &graph, WDEntry *WD, AnytimeOptions &options) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+
+    std::vector<Edge> opt_edges;
+    add_7_1_edges(graph, opt_edges);
+    int *distance = (int *) malloc(sizeof(int) * (vertex_count+1));
+
+    AnytimeResult result = opt_anytime(graph, WD, options, [&](int current_c, int *r) {
+        add_7_2_edges(graph, WD, current_c, opt_edges);
+        Graph opt_graph(graph.vertices, &opt_edges[0], vertex_count, opt_edges.size());
+        bool found = bellman(opt_graph, distance);
+        opt_edges.erase(opt_edges.begin() + edge_count, opt_edges.end());
+
+        if(!found) return -1;
+        for (int i = 0; i < vertex_count; ++i) {
+            r[i] = distance[i];
+        }
+        return current_c;
+    });
+
+    free(distance);
+    return result;
+}
+
+/**
+ * Anytime OPT2 ALGORITHM
+ * Same binary search as opt2, bounded by options.deadline and options.cancel.
+ * Each probe runs feas.
+ * Returns an AnytimeResult with the best retiming found and the remaining bounds of the optimal clock period.
+ */
+AnytimeResult opt2_anytime(Graph &graph, WDEntry *WD, AnytimeOptions &options) {
+    int vertex_count = graph.vertex_count;
+    int *deltas = (int *) malloc(sizeof(int) * vertex_count);
+
+    AnytimeResult result = opt_anytime(graph, WD, options, [&](int current_c, int *r) {
+        FeasResult feas_result = feas(graph, current_c, deltas);
+        int c = feas_result.r ? feas_result.c : -1;
+        if(feas_result.r) {
+            for (int i = 0; i < vertex_count; ++i) {
+                r[i] = feas_result.graph.vertices[i].weight;
+            }
+        }
+        free(feas_result.graph.vertices);
+        free(feas_result.graph.edges);
+        return c;
+    });
+
+    free(deltas);
+    return result;
+}
+
+#endif
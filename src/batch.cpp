@@ -0,0 +1,379 @@
+#ifndef BATCH
+#define BATCH
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+#include "types.h"
+#include "circuit_view.cpp"
+#include "graph_io.cpp"
+#include "netlist_importer.cpp"
+#include "cycle_finder.cpp"
+
+//#define BATCHDEBUG
+
+#ifdef BATCHDEBUG
+#include <iostream>
+#endif
+
+/**
+ * Batch retiming of many circuit files over a work-stealing thread pool.
+ * Each worker owns its scratch memory (the circuit arrays, the WD matrix and the retiming), grown as needed and reused
+ * from one circuit to the next, and runs the CircuitView algorithms on it, so jobs do not allocate once the workers have
+ * seen their biggest circuit.
+ */
+
+enum BatchAlgorithm { BATCH_AUTO, BATCH_OPT1, BATCH_OPT2 };
+const char *batch_algorithm_names[] = { "auto", "opt1", "opt2" };
+
+struct BatchOptions {
+    BatchAlgorithm algorithm = BATCH_AUTO;
+    int thread_count = std::thread::hardware_concurrency();
+    std::string output_dir; //where the retimed graph files are written (file name + ".retimed"), none if empty
+    NetlistOptions netlist_options; //for .bench and .blif files
+};
+
+struct BatchJobResult {
+    std::string path;
+    bool r; //retimed and verified
+    std::string error; //reason, if it was not retimed
+    int worker;
+    int vertex_count;
+    int edge_count;
+    BatchAlgorithm algorithm; //opt1 or opt2, the one used
+    int initial_c;
+    int c;
+    bool cached_wd; //WD was read from the graph file
+    //milliseconds of each step
+    double load_time;
+    double wd_time;
+    double opt_time;
+    double verify_time;
+    double write_time;
+};
+
+//Per worker memory, reused by its jobs
+struct BatchScratch {
+    std::vector<int> delays;
+    std::vector<int> from;
+    std::vector<int> to;
+    std::vector<int> weight;
+    std::vector<int> r;
+    std::vector<int> deltas;
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+    WDEntry *WD;
+    size_t wd_capacity;
+
+    BatchScratch(): WD(nullptr), wd_capacity(0) {}
+
+    ~BatchScratch() {
+        free(WD);
+    }
+
+    //Grows the WD matrix, returns false if it could not be allocated
+    bool reserve_wd(size_t size) {
+        if(size <= wd_capacity) return true;
+        free(WD);
+        WD = (WDEntry *) malloc(sizeof(WDEntry) * size);
+        wd_capacity = WD ? size : 0;
+        return WD != nullptr;
+    }
+};
+
+//Vertices of the longest 0 weight path (0 if there is a 0 weight cycle), with Kahn's topological order. O(V + E).
+int batch_zero_weight_depth(CircuitView &view) {
+    ViewIndex index(view);
+    std::vector<int> in_degree(view.vertex_count, 0);
+    std::vector<int> depth(view.vertex_count, 1);
+    for (int e = 0; e < view.edge_count; ++e) {
+        if(view.weight[e] == 0) ++in_degree[view.to[e]];
+    }
+    std::vector<int> ready;
+    for (int v = 0; v < view.vertex_count; ++v) {
+        if(in_degree[v] == 0) ready.push_back(v);
+    }
+    int max_depth = 0;
+    int sorted = 0;
+    while(!ready.empty()) {
+        int u = ready.back();
+        ready.pop_back();
+        ++sorted;
+        max_depth = std::max(max_depth, depth[u]);
+        for (int i = index.offsets[u]; i < index.offsets[u+1]; ++i) {
+            int e = index.edge_ids[i];
+            if(view.weight[e] != 0) continue;
+            depth[view.to[e]] = std::max(depth[view.to[e]], depth[u] + 1);
+            if(--in_degree[view.to[e]] == 0) ready.push_back(view.to[e]);
+        }
+    }
+    return sorted == view.vertex_count ? max_depth : 0;
+}
+
+/**
+ * OPT1 or OPT2 for a circuit. Each FEAS probe of OPT2 makes up to V - 1 CP passes, as many as it takes registers to
+ * move along the 0 weight paths, so it falls behind the Bellman-Ford of OPT1 on circuits with long combinational chains
+ * (rings, correlators) and wins on the rest.
+ */
+BatchAlgorithm choose_batch_algorithm(CircuitView &view) {
+    return (long long) batch_zero_weight_depth(view) * 4 >= view.vertex_count ? BATCH_OPT1 : BATCH_OPT2;
+}
+
+double batch_milliseconds(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+//Error of a circuit WD or CP refused, naming the vertices of one of its 0 weight cycles
+std::string batch_zero_weight_cycle_error(CircuitView &view, BatchScratch &scratch) {
+    scratch.edges.clear();
+    for (int e = 0; e < view.edge_count; ++e) {
+        scratch.edges.push_back(Edge(view.from[e], view.to[e], view.weight[e]));
+    }
+    Graph graph(nullptr, scratch.edges.data(), view.vertex_count, view.edge_count);
+    return zero_weight_cycle_message(graph);
+}
+
+bool batch_has_extension(std::string &path, const char *extension) {
+    size_t size = strlen(extension);
+    return path.size() >= size && path.compare(path.size() - size, size, extension) == 0;
+}
+
+void batch_copy_graph(Graph &graph, BatchScratch &scratch) {
+    scratch.delays.resize(graph.vertex_count);
+    scratch.from.resize(graph.edge_count);
+    scratch.to.resize(graph.edge_count);
+    scratch.weight.resize(graph.edge_count);
+    for (int v = 0; v < graph.vertex_count; ++v) {
+        scratch.delays[v] = graph.vertices[v].weight;
+    }
+    for (int e = 0; e < graph.edge_count; ++e) {
+        scratch.from[e] = graph.edges[e].from;
+        scratch.to[e] = graph.edges[e].to;
+        scratch.weight[e] = graph.edges[e].weight;
+    }
+}
+
+//Writes the retimed graph as in OptResult: vertex weights are r, edge weights the retimed registers
+bool batch_write_retimed(CircuitView &view, BatchScratch &scratch, std::string path) {
+    scratch.vertices.clear();
+    scratch.edges.clear();
+    for (int v = 0; v < view.vertex_count; ++v) {
+        scratch.vertices.push_back(Vertex(scratch.r[v]));
+    }
+    for (int e = 0; e < view.edge_count; ++e) {
+        scratch.edges.push_back(Edge(view.from[e], view.to[e], view_retimed_weight(view, &scratch.r[0], e)));
+    }
+
+    GraphFileWriter writer;
+    if(!writer.open(path, view.vertex_count)) return false;
+    writer.write_vertices(0, scratch.vertices.data(), view.vertex_count);
+    writer.append_edges(scratch.edges.data(), view.edge_count);
+    return writer.close();
+}
+
+/**
+ * Retimes one circuit file with the worker scratch memory.
+ * .bench and .blif files are imported as netlists, anything else is mapped as a binary graph file (see graph_io.cpp),
+ * whose WD section is used if it has one.
+ */
+BatchJobResult run_batch_job(std::string path, BatchOptions &options, BatchScratch &scratch, int worker) {
+    BatchJobResult result = {};
+    result.path = path;
+    result.worker = worker;
+    result.initial_c = -1;
+    result.c = -1;
+
+    //load
+    auto begin = std::chrono::steady_clock::now();
+    MappedGraph mapped = {};
+    if(batch_has_extension(path, ".bench") || batch_has_extension(path, ".blif")) {
+        NetlistResult netlist = import_netlist(path, batch_has_extension(path, ".bench") ? BENCH : BLIF, options.netlist_options);
+        if(!netlist.r) {
+            result.error = netlist.error;
+            return result;
+        }
+        batch_copy_graph(netlist.graph, scratch);
+        free(netlist.graph.vertices);
+        free(netlist.graph.edges);
+    } else {
+        mapped = map_graph(path);
+        if(!mapped.r) {
+            result.error = "not a graph file";
+            return result;
+        }
+        batch_copy_graph(mapped.graph, scratch);
+    }
+    int vertex_count = scratch.delays.size();
+    int edge_count = scratch.from.size();
+    CircuitView view = { scratch.delays.data(), vertex_count, scratch.from.data(), scratch.to.data(), scratch.weight.data(), edge_count };
+    result.vertex_count = vertex_count;
+    result.edge_count = edge_count;
+    scratch.r.resize(vertex_count);
+    scratch.deltas.resize(vertex_count);
+    result.load_time = batch_milliseconds(begin);
+
+    if(vertex_count == 0) {
+        unmap_graph(mapped);
+        result.error = "empty circuit";
+        return result;
+    }
+
+    //wd
+    begin = std::chrono::steady_clock::now();
+    WDEntry *WD = mapped.WD;
+    result.cached_wd = WD != nullptr;
+    if(!WD) {
+        if(!scratch.reserve_wd((size_t) vertex_count * vertex_count)) {
+            unmap_graph(mapped);
+            result.error = "WD matrix does not fit in memory";
+            return result;
+        }
+        WD = scratch.WD;
+        if(!view_wd(view, WD)) {
+            unmap_graph(mapped);
+            result.error = batch_zero_weight_cycle_error(view, scratch);
+            return result;
+        }
+    }
+    result.wd_time = batch_milliseconds(begin);
+
+    //opt
+    begin = std::chrono::steady_clock::now();
+    result.algorithm = options.algorithm == BATCH_AUTO ? choose_batch_algorithm(view) : options.algorithm;
+    ViewResult opt_result = result.algorithm == BATCH_OPT1 ? view_opt1(view, WD, scratch.r.data()) : view_opt2(view, WD, scratch.r.data());
+    result.opt_time = batch_milliseconds(begin);
+    unmap_graph(mapped);
+
+    //verify, without WD: no negative edge and the period of the retimed circuit is the one found
+    begin = std::chrono::steady_clock::now();
+    ViewIndex index(view);
+    result.initial_c = view_cp(view, index, nullptr, scratch.deltas.data());
+    bool legal = opt_result.r;
+    for (int e = 0; e < edge_count && legal; ++e) {
+        legal = view_retimed_weight(view, scratch.r.data(), e) >= 0;
+    }
+    if(legal) {
+        result.c = view_cp(view, index, scratch.r.data(), scratch.deltas.data());
+        legal = result.c >= 0 && result.c <= opt_result.c;
+    }
+    result.verify_time = batch_milliseconds(begin);
+    if(!legal) {
+        result.error = opt_result.r ? "illegal retiming" : "no retiming found";
+        return result;
+    }
+
+    //write
+    if(!options.output_dir.empty()) {
+        begin = std::chrono::steady_clock::now();
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        if(!batch_write_retimed(view, scratch, options.output_dir + "/" + name + ".retimed")) {
+            result.error = "could not write the retimed graph";
+            return result;
+        }
+        result.write_time = batch_milliseconds(begin);
+    }
+
+    result.r = true;
+    return result;
+}
+
+//Jobs of a worker: the owner takes them from the front, thieves from the back
+struct BatchQueue {
+    std::mutex mutex;
+    std::deque<int> jobs;
+};
+
+bool batch_next_job(std::vector<BatchQueue> &queues, int worker, int *job) {
+    int worker_count = queues.size();
+    for (int i = 0; i < worker_count; ++i) {
+        BatchQueue &queue = queues[(worker + i) % worker_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.jobs.empty()) continue;
+        if(i == 0) {
+            *job = queue.jobs.front();
+            queue.jobs.pop_front();
+        } else {
+            *job = queue.jobs.back();
+            queue.jobs.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Retimes every circuit file over options.thread_count workers.
+ * Jobs are dealt to the workers biggest file first, and idle workers steal from the others.
+ * Returns the result of each file, in the order of paths.
+ */
+std::vector<BatchJobResult> run_batch(std::vector<std::string> &paths, BatchOptions &options) {
+    int job_count = paths.size();
+    int worker_count = std::max(1, std::min(options.thread_count, job_count));
+    std::vector<BatchJobResult> results(job_count);
+
+    std::vector<std::pair<long long, int>> sizes;
+    for (int i = 0; i < job_count; ++i) {
+        struct stat file_stat;
+        sizes.push_back({stat(paths[i].c_str(), &file_stat) == 0 ? (long long) file_stat.st_size : 0, i});
+    }
+    std::sort(sizes.begin(), sizes.end(), std::greater<std::pair<long long, int>>());
+
+    std::vector<BatchQueue> queues(worker_count);
+    for (int i = 0; i < job_count; ++i) {
+        queues[i % worker_count].jobs.push_back(sizes[i].second);
+    }
+
+    //netlists are imported by the worker thread alone
+    BatchOptions worker_options = options;
+    worker_options.netlist_options.thread_count = 1;
+
+    auto work = [&](int worker) {
+        BatchScratch scratch;
+        int job;
+        while(batch_next_job(queues, worker, &job)) {
+            results[job] = run_batch_job(paths[job], worker_options, scratch, worker);
+#ifdef BATCHDEBUG
+            printf("[Batch] worker %d: %s %s\n", worker, paths[job].c_str(), results[job].r ? "ok" : results[job].error.c_str());
+#endif
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < worker_count; ++w) {
+        threads.push_back(std::thread(work, w));
+    }
+    work(0);
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    return results;
+}
+
+/**
+ * Writes the batch results as tab separated values, one line per file, to path ("-" for stdout).
+ * Returns true if the report was written.
+ */
+bool write_batch_report(std::vector<BatchJobResult> &results, std::string path) {
+    FILE *file = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if(!file) return false;
+
+    fprintf(file, "path\tstatus\tworker\tvertices\tedges\talgorithm\tinitial_c\tc\tcached_wd\tload_ms\twd_ms\topt_ms\tverify_ms\twrite_ms\n");
+    for (BatchJobResult &result: results) {
+        fprintf(file, "%s\t%s\t%d\t%d\t%d\t%s\t%d\t%d\t%d\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\n", result.path.c_str(),
+                result.r ? "ok" : result.error.c_str(), result.worker, result.vertex_count, result.edge_count,
+                batch_algorithm_names[result.algorithm], result.initial_c, result.c, result.cached_wd, result.load_time,
+                result.wd_time, result.opt_time, result.verify_time, result.write_time);
+    }
+
+    if(file == stdout) return fflush(stdout) == 0;
+    return fclose(file) == 0;
+}
+
+#endif
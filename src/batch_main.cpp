@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include "batch.cpp"
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-j threads] [-a auto|opt1|opt2] [-o output_dir] [-r report.tsv] [-l list_file] [circuit_file...]\n"
+            "  -j  worker threads (default: hardware threads)\n"
+            "  -a  algorithm, auto picks opt1 or opt2 per circuit (default: auto)\n"
+            "  -o  directory where the retimed graph files are written, as <file name>.retimed\n"
+            "  -r  report file, - for stdout (default: -)\n"
+            "  -l  file with one circuit file per line\n"
+            "Circuit files are binary graph files, .bench or .blif netlists.\n", program);
+}
+
+int main(int argc, char **argv) {
+    BatchOptions options;
+    std::string report_path = "-";
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i+1 < argc;
+        if(arg == "-j" && has_value) {
+            options.thread_count = atoi(argv[++i]);
+        } else if(arg == "-a" && has_value) {
+            std::string name = argv[++i];
+            if(name == "auto") options.algorithm = BATCH_AUTO;
+            else if(name == "opt1") options.algorithm = BATCH_OPT1;
+            else if(name == "opt2") options.algorithm = BATCH_OPT2;
+            else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if(arg == "-o" && has_value) {
+            options.output_dir = argv[++i];
+        } else if(arg == "-r" && has_value) {
+            report_path = argv[++i];
+        } else if(arg == "-l" && has_value) {
+            std::ifstream list(argv[++i]);
+            if(!list) {
+                fprintf(stderr, "Could not read %s\n", argv[i]);
+                return 1;
+            }
+            std::string line;
+            while(std::getline(list, line)) {
+                if(!line.empty()) paths.push_back(line);
+            }
+        } else if(arg[0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if(paths.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<BatchJobResult> results = run_batch(paths, options);
+    double time = batch_milliseconds(begin);
+
+    if(!write_batch_report(results, report_path)) {
+        fprintf(stderr, "Could not write %s\n", report_path.c_str());
+        return 1;
+    }
+
+    int failed = 0;
+    for (BatchJobResult &result: results) {
+        if(!result.r) ++failed;
+    }
+    fprintf(stderr, "%d circuits, %d failed, %.3f s\n", (int) results.size(), failed, time / 1000);
+
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,135 @@
+#ifndef BENCHFIXTURES
+#define BENCHFIXTURES
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "circuit_generator.cpp"
+#include "circuit_families.cpp"
+#include "graph_io.cpp"
+#include "wd.cpp"
+#include "opt.cpp"
+
+//#define BENCHFIXTURESDEBUG
+
+#ifdef BENCHFIXTURESDEBUG
+#include <iostream>
+#endif
+
+/**
+ * Benchmark fixtures: seeded graphs built the first time a benchmark asks for them, and cached on disk as binary graph
+ * files (see graph_io.cpp) in the RETIMING_FIXTURES directory (bench_fixtures by default), so every run and every
+ * version benchmarks the very same graphs.
+ * The optimal clock period of each fixture, needed by FEAS and Bellman-Ford benchmarks, is computed once with WD + OPT2
+ * when first asked for, outside of any timed region.
+ */
+
+const unsigned int FIXTURE_SEED = 20200601;
+
+const int graph_count = 12;
+const int graph_max_index = graph_count-1;
+const int graph_min_size_log = 3; //graph i has 2^(graph_min_size_log+i) vertices
+
+const int opt2_wc_graph_count = 7;
+const int opt2_wc_graph_max_index = opt2_wc_graph_count-1;
+const int opt2_wc_min_size_log = 6;
+
+const int family_size_count = 8;
+const int family_size_max_index = family_size_count-1;
+const int family_min_size_log = 4; //family graph i has around 2^(family_min_size_log+i) vertices
+
+struct Fixture {
+    bool built;
+    Graph graph;
+    int period; //optimal clock period, -1 until computed
+};
+
+std::string fixture_dir() {
+    const char *dir = getenv("RETIMING_FIXTURES");
+    return dir ? dir : "bench_fixtures";
+}
+
+//Reads the fixture from the cache, or builds it with generate and caches it
+template<typename Generator>
+void load_fixture(Fixture &fixture, std::string name, Generator generate) {
+    if(fixture.built) return;
+    std::string dir = fixture_dir();
+    std::string path = dir + "/" + name + ".graph";
+    if(!read_graph(path, &fixture.graph)) {
+        fixture.graph = generate();
+        mkdir(dir.c_str(), 0755);
+        write_graph(fixture.graph, path);
+#ifdef BENCHFIXTURESDEBUG
+        printf("[Fixtures] built %s\n", path.c_str());
+#endif
+    }
+    fixture.built = true;
+    fixture.period = -1;
+}
+
+//Generate a graph for the OPT2 worst case
+Graph generate_opt2_wc_circuit(int vertex_count) {
+    int edge_count = vertex_count;
+    Vertex *vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    Edge   *edges    = (Edge *)   malloc(sizeof(Edge) * edge_count);
+
+    vertices[0] = Vertex(vertex_count-1);
+    edges[0]    = Edge(edge_count-1, 0, 1);
+    for (int i = 1; i < vertex_count; ++i) {
+        vertices[i] = Vertex(vertex_count-i-1);
+        edges[i] = Edge(i-1, i, 0);
+    }
+
+    return Graph(vertices, edges, vertex_count, edge_count);
+}
+
+Fixture random_fixtures[graph_count];
+Fixture opt2_wc_fixtures[opt2_wc_graph_count];
+Fixture family_fixtures[circuit_family_count][family_size_count];
+
+//Random circuit with 2^(graph_min_size_log+index) vertices
+Fixture &random_fixture(int index) {
+    Fixture &fixture = random_fixtures[index];
+    int vertex_count = 1 << (graph_min_size_log + index);
+    unsigned int seed = FIXTURE_SEED + index;
+    load_fixture(fixture, "random_" + std::to_string(vertex_count) + "_" + std::to_string(seed),
+            [&]() { return generate_circuit(vertex_count, seed); });
+    return fixture;
+}
+
+//OPT2 worst case circuit with 2^(opt2_wc_min_size_log+index) vertices
+Fixture &opt2_wc_fixture(int index) {
+    Fixture &fixture = opt2_wc_fixtures[index];
+    int vertex_count = 1 << (opt2_wc_min_size_log + index);
+    load_fixture(fixture, "opt2_wc_" + std::to_string(vertex_count),
+            [&]() { return generate_opt2_wc_circuit(vertex_count); });
+    return fixture;
+}
+
+//Circuit of the family with around 2^(family_min_size_log+index) vertices
+Fixture &family_fixture(int family, int index) {
+    Fixture &fixture = family_fixtures[family][index];
+    int size_log = family_min_size_log + index;
+    unsigned int seed = FIXTURE_SEED + index;
+    load_fixture(fixture, std::string("family_") + circuit_family_names[family] + "_" + std::to_string(size_log) + "_" + std::to_string(seed),
+            [&]() { return generate_family_circuit((CircuitFamily) family, size_log, seed); });
+    return fixture;
+}
+
+//Optimal clock period of the fixture, computed with WD + OPT2 the first time
+int fixture_period(Fixture &fixture) {
+    if(fixture.period >= 0) return fixture.period;
+    WDEntry *WD = wd(fixture.graph);
+    OptResult result = opt2(fixture.graph, WD);
+    fixture.period = result.c;
+    if(result.r) {
+        free(result.graph.vertices);
+        free(result.graph.edges);
+    }
+    free(WD);
+    return fixture.period;
+}
+
+#endif
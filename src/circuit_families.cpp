@@ -0,0 +1,219 @@
+#ifndef CIRCUITFAMILIES
+#define CIRCUITFAMILIES
+
+#include <vector>
+#include "circuit_generator.cpp"
+#include "types.h"
+
+//#define CIRCUITFAMILIESDEBUG
+
+#ifdef CIRCUITFAMILIESDEBUG
+#include <iostream>
+#include "graph_printer.cpp"
+#endif
+
+/**
+ * Structured circuit families.
+ * Every family is built around a host vertex 0 (delay 0) that feeds the inputs and takes the outputs, the way
+ * the correlator of the retiming paper models the environment. Registers start piled up where a naive design
+ * would put them, so there is work left for retiming.
+ * Gate delays are random (chi-squared, at least 1) but given by seed, the structure only by the parameters.
+ */
+
+//Copies the vertex and edge vectors into a malloc'd graph
+Graph make_graph(std::vector<Vertex> &vertices_v, std::vector<Edge> &edges_v) {
+    Vertex *vertices = (Vertex *) malloc(sizeof(Vertex) * vertices_v.size());
+    Edge *edges = (Edge *) malloc(sizeof(Edge) * edges_v.size());
+    for (int i = 0; i < (int) vertices_v.size(); ++i) {
+        vertices[i] = vertices_v[i];
+    }
+    for (int i = 0; i < (int) edges_v.size(); ++i) {
+        edges[i] = edges_v[i];
+    }
+    return Graph(vertices, edges, vertices_v.size(), edges_v.size());
+}
+
+int gate_delay(RandomCalculator &rand) {
+    return std::max(1, rand.vertex_weight());
+}
+
+/**
+ * Pipelined datapath: stages of width gates, each gate fed by two gates of the previous stage.
+ * The first stage is fed by the host and the last one feeds it back through stages registers,
+ * all of the pipeline registers being at the output (retiming spreads them over the stages).
+ * Vertices: 1 + stages * width.
+ */
+Graph generate_pipeline_circuit(int stages, int width, unsigned int seed = 0) {
+    RandomCalculator rand(0, 5, seed);
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+
+    vertices.push_back(Vertex(0));
+    for (int s = 0; s < stages; ++s) {
+        for (int i = 0; i < width; ++i) {
+            int v = vertices.size();
+            vertices.push_back(Vertex(gate_delay(rand)));
+            if(s == 0) {
+                edges.push_back(Edge(0, v, 0));
+            } else {
+                int previous = v - width;
+                edges.push_back(Edge(previous, v, 0));
+                if(width > 1) edges.push_back(Edge(previous - i + (i+1) % width, v, 0));
+            }
+            if(s == stages-1) edges.push_back(Edge(v, 0, stages));
+        }
+    }
+
+    return make_graph(vertices, edges);
+}
+
+/**
+ * Mesh of rows x cols cells, each cell feeding its right and bottom neighbours (systolic array before pipelining).
+ * The first row and column are fed by the host and the last row and column feed it back through rows + cols registers,
+ * so retiming can turn it into a systolic array.
+ * Vertices: 1 + rows * cols.
+ */
+Graph generate_mesh_circuit(int rows, int cols, unsigned int seed = 0) {
+    RandomCalculator rand(0, 5, seed);
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+
+    vertices.push_back(Vertex(0));
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            int v = vertices.size();
+            vertices.push_back(Vertex(gate_delay(rand)));
+            if(i == 0 || j == 0) edges.push_back(Edge(0, v, 0));
+            if(j > 0) edges.push_back(Edge(v-1, v, 0));
+            if(i > 0) edges.push_back(Edge(v-cols, v, 0));
+            if(i == rows-1 || j == cols-1) edges.push_back(Edge(v, 0, rows + cols));
+        }
+    }
+
+    return make_graph(vertices, edges);
+}
+
+/**
+ * Correlator with taps comparators, generalizing the correlator of the retiming paper (taps = 4):
+ * a tapped delay line of comparators with a register between taps, whose outputs are summed by a chain of taps-1 adders
+ * without registers that feeds the host.
+ * Vertices: 2 * taps.
+ */
+Graph generate_correlator_circuit(int taps, int comparator_delay = 3, int adder_delay = 7) {
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+
+    //host 0, comparators 1..taps, adders taps+1..2*taps-1
+    vertices.push_back(Vertex(0));
+    for (int i = 1; i <= taps; ++i) {
+        vertices.push_back(Vertex(comparator_delay));
+    }
+    for (int i = 1; i < taps; ++i) {
+        vertices.push_back(Vertex(adder_delay));
+    }
+
+    edges.push_back(Edge(0, 1, 1));
+    for (int i = 1; i < taps; ++i) {
+        edges.push_back(Edge(i, i+1, 1));
+    }
+    if(taps == 1) {
+        edges.push_back(Edge(1, 0, 0));
+        return make_graph(vertices, edges);
+    }
+
+    //comparator taps and taps-1 feed the first adder, comparator i the adder taps-i
+    edges.push_back(Edge(taps, taps+1, 0));
+    for (int i = taps-1; i >= 1; --i) {
+        edges.push_back(Edge(i, taps + (taps-i), 0));
+    }
+    for (int i = taps+1; i < 2*taps-1; ++i) {
+        edges.push_back(Edge(i, i+1, 0));
+    }
+    edges.push_back(Edge(2*taps-1, 0, 0));
+
+    return make_graph(vertices, edges);
+}
+
+/**
+ * Ring of vertex_count gates with all of its registers on the edge that closes it,
+ * plus a feedback edge with a register every 4 gates, back to the gate 3 positions before.
+ * Vertices: vertex_count.
+ */
+Graph generate_ring_circuit(int vertex_count, int registers, unsigned int seed = 0) {
+    RandomCalculator rand(0, 5, seed);
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+
+    for (int v = 0; v < vertex_count; ++v) {
+        vertices.push_back(Vertex(gate_delay(rand)));
+        edges.push_back(Edge(v, (v+1) % vertex_count, v == vertex_count-1 ? registers : 0));
+        if(v >= 3 && v % 4 == 3) edges.push_back(Edge(v, v-3, 1));
+    }
+
+    return make_graph(vertices, edges);
+}
+
+/**
+ * Complete fanout tree of the given depth: the host drives the root, every gate drives fanout gates of the next level,
+ * and every leaf feeds the host back through depth registers.
+ * Vertices: 1 + (fanout^(depth+1) - 1) / (fanout - 1).
+ */
+Graph generate_fanout_tree_circuit(int depth, int fanout, unsigned int seed = 0) {
+    RandomCalculator rand(0, 5, seed);
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+
+    vertices.push_back(Vertex(0));
+    vertices.push_back(Vertex(gate_delay(rand)));
+    edges.push_back(Edge(0, 1, 0));
+
+    int level_begin = 1;
+    int level_end = 2;
+    for (int d = 0; d < depth; ++d) {
+        for (int u = level_begin; u < level_end; ++u) {
+            for (int i = 0; i < fanout; ++i) {
+                edges.push_back(Edge(u, vertices.size(), 0));
+                vertices.push_back(Vertex(gate_delay(rand)));
+            }
+        }
+        level_begin = level_end;
+        level_end = vertices.size();
+    }
+    for (int u = level_begin; u < level_end; ++u) {
+        edges.push_back(Edge(u, 0, std::max(1, depth)));
+    }
+
+    return make_graph(vertices, edges);
+}
+
+enum CircuitFamily { PIPELINE, MESH, CORRELATOR, RING, FANOUT_TREE };
+const int circuit_family_count = 5;
+const char *circuit_family_names[] = { "pipeline", "mesh", "correlator", "ring", "fanout_tree" };
+
+/**
+ * Member of a family with around 2^size_log vertices, for size sweeps.
+ */
+Graph generate_family_circuit(CircuitFamily family, int size_log, unsigned int seed = 0) {
+    switch(family) {
+        case PIPELINE: return generate_pipeline_circuit(1 << (size_log - size_log/2), 1 << (size_log/2), seed);
+        case MESH: return generate_mesh_circuit(1 << (size_log/2), 1 << (size_log - size_log/2), seed);
+        case CORRELATOR: return generate_correlator_circuit(1 << (size_log-1));
+        case RING: return generate_ring_circuit(1 << size_log, (1 << size_log) / 8 + 1, seed);
+        case FANOUT_TREE: return generate_fanout_tree_circuit(size_log-1, 2, seed);
+    }
+    return Graph();
+}
+
+#ifdef CIRCUITFAMILIESDEBUG
+int main_families() {
+    for (int f = 0; f < circuit_family_count; ++f) {
+        Graph graph = generate_family_circuit((CircuitFamily) f, 4);
+        to_dot(graph, std::string(circuit_family_names[f]) + ".dot");
+        free(graph.vertices);
+        free(graph.edges);
+    }
+    return 0;
+}
+#endif
+
+#endif
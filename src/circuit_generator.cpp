@@ -3,12 +3,16 @@
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/connected_components.hpp>
-#include <boost/graph/johnson_all_pairs_shortest.hpp>
 #include <vector>
 #include <random>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <math.h>
 
-#include "cycle_finder.cpp" 
+#include "graph_io.cpp"
 #include "types.h"
 
 #ifdef CIRCUITGENDEBUG
@@ -20,13 +24,12 @@
 //#define CIRCUITGENDEBUG
 
 struct RandomCalculator {
-    std::random_device rd;
     std::mt19937 gen;
     std::uniform_real_distribution<> edge_dis; // Uniform distribution for edge between two vertices.
     std::normal_distribution<> edge_weight_dis; // Normal distribution for edge weight.
     std::chi_squared_distribution<> vertex_weight_dis; // Chi-sq distribution for vertex weight.
 
-    RandomCalculator(int edge_u, int edge_phi): gen(rd()),
+    RandomCalculator(int edge_u, int edge_phi, unsigned int seed): gen(seed),
                         edge_dis(0, 1), 
                         edge_weight_dis(edge_u, edge_phi), 
                         vertex_weight_dis(4.0) {}
@@ -43,38 +46,78 @@ struct RandomCalculator {
         return std::abs(edge_weight_dis(gen));
     }
 
+    // Edge weight > 0
+    int positive_edge_weight() {
+        int weight = edge_weight();
+        while(weight == 0) {
+            weight = edge_weight();
+        }
+        return weight;
+    }
+
+    // Amount of failed trials before the next success, each trial succeeding with probability p.
+    long long skip(double p) {
+        std::geometric_distribution<long long> skip_dis(p);
+        return skip_dis(gen);
+    }
+
     int uniform(int from, int to) {
         std::uniform_real_distribution<> uniform_dis(from, to);
         return uniform_dis(gen);
     }
 };
 
-Graph generate_circuit(int vertex_count) {
+/**
+ * Generates a random circuit graph, connected and without 0 weight cycles.
+ * Every ordered pair of vertices gets an edge with probability 2 / vertex_count (around 2 edges per vertex),
+ * sampled by skipping over the pairs with a geometric distribution, so it runs in O(V + E).
+ * 0 weight edges are only kept if they go forward in a random order of the vertices, any other edge gets registers,
+ * so no 0 weight cycle can be formed.
+ * seed: seed of the random generator, the same seed always generates the same graph.
+ */
+Graph generate_circuit(int vertex_count, unsigned int seed = std::random_device()()) {
     int edge_u = 0;
     int edge_phi = 5;
     // Probability of edge between two vertices (around 2 edges per vertex)
-    double edge_p = 2.0 / vertex_count; 
+    double edge_p = std::min(1.0, 2.0 / vertex_count);
 
-    RandomCalculator rand(edge_u, edge_phi);
+    RandomCalculator rand(edge_u, edge_phi, seed);
 
     std::vector<Edge> edges_v;
 
     Vertex *vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
-
-    // Random circuit
     for (int i = 0; i < vertex_count; ++i) {
         vertices[i] = Vertex(rand.vertex_weight());
+    }
 
-        // Random edges from current vertex
-        double multiplier = 1;
-        for (int j = 0; j < vertex_count; ++j) {
-            if(i == j) continue;
-            if(rand.edge() < edge_p * multiplier) {
-                edges_v.push_back(Edge(i, j, rand.edge_weight()));
-                --j; multiplier /= 3;// Reroll same edge (parallel edges), with 1/3 the chance
-            } else {
-                multiplier = 1;
-            }
+    // Random order of the vertices, 0 weight edges only go forward in it
+    std::vector<int> order(vertex_count);
+    for (int i = 0; i < vertex_count; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rand.gen);
+    std::vector<int> position(vertex_count);
+    for (int i = 0; i < vertex_count; ++i) {
+        position[order[i]] = i;
+    }
+
+    auto add_edge_v = [&](int from, int to) {
+        int weight = rand.edge_weight();
+        if(weight == 0 && position[from] >= position[to]) weight = rand.positive_edge_weight();
+        edges_v.push_back(Edge(from, to, weight));
+    };
+
+    // Random edges: pair k is (k / (vertex_count-1), k % (vertex_count-1)), skipping the vertex itself
+    long long pair_count = (long long) vertex_count * (vertex_count-1);
+    for (long long k = rand.skip(edge_p); k < pair_count; k += 1 + rand.skip(edge_p)) {
+        int i = k / (vertex_count-1);
+        int j = k % (vertex_count-1);
+        if(j >= i) ++j;
+
+        add_edge_v(i, j);
+        // Reroll same edge (parallel edges), with 1/3 the chance each time
+        for (double multiplier = 1.0/3; rand.edge() < edge_p * multiplier; multiplier /= 3) {
+            add_edge_v(i, j);
         }
     }
 
@@ -112,7 +155,7 @@ Graph generate_circuit(int vertex_count) {
             for (int i = 0; i < components-1; ++i) {
                 int from = rand.uniform(0, component_vertices[i].size()-0.01);
                 int to = rand.uniform(0, component_vertices[i+1].size()-0.01);
-                edges_v.push_back(Edge(component_vertices[i][from], component_vertices[i+1][to], rand.edge_weight()));
+                add_edge_v(component_vertices[i][from], component_vertices[i+1][to]);
 #ifdef CIRCUITGENDEBUG
                 printf("Adding edge %d -> %d\n", component_vertices[i][from], component_vertices[i+1][to]);
 #endif
@@ -131,49 +174,122 @@ Graph generate_circuit(int vertex_count) {
     // Create graph
     Graph graph(vertices, edges, vertex_count, edge_count);
 
-    // Find 0-weight cycles in circuit
-    bool check_cycles = true;
-    while (check_cycles) {
-        std::vector<std::vector<Edge *>> cycles;
-        find_zero_weight_cycles(&cycles, graph);
+    return graph;
+}
 
-        int cycle_count = cycles.size();
-        if(cycle_count == 0) check_cycles = false;
 
-#ifdef CIRCUITGENDEBUG
-        printf("cycles: %d\n", cycle_count);
-        for(int i = 0; i < cycle_count; ++i) {
-            printf("cycle: %d\n", i);
-            for(int j = 0; j < cycle_count; ++j) {
-                Edge *edge = cycles[i][j];
-                printf("(%d, %d, [%d]) \n", edge->from, edge->to, edge->weight);
+const int CIRCUIT_FILE_BLOCK_SIZE = 1<<16;
+
+//splitmix64 finalizer, used to derive independent seeds and priorities from a single seed
+uint64_t mix_seed(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Generates a random circuit graph straight into a binary graph file (see graph_io.cpp), without keeping it in memory.
+ * The vertices are split in blocks of CIRCUIT_FILE_BLOCK_SIZE, each one with its own random generator seeded from
+ * seed and the block index, and generated by thread_count threads. Blocks are written in order, so the file is
+ * the same for a given seed whatever the amount of threads.
+ * - Each vertex v > 0 gets an edge from or to a random vertex u < v, a random tree that keeps the graph connected.
+ * - Every ordered pair of vertices gets an edge with probability 1 / vertex_count (around 2 edges per vertex in total).
+ * - 0 weight edges only go forward in the order given by a hash of each vertex, so there are no 0 weight cycles.
+ * Only the blocks being generated are held in memory.
+ * Returns true if the file was written.
+ */
+bool generate_circuit_file(std::string path, int vertex_count, unsigned int seed, int thread_count = std::thread::hardware_concurrency()) {
+    int edge_u = 0;
+    int edge_phi = 5;
+    double edge_p = std::min(1.0, 1.0 / vertex_count);
+    if(thread_count < 1) thread_count = 1;
+
+    GraphFileWriter writer;
+    if(!writer.open(path, vertex_count)) {
+        writer.close();
+        return false;
+    }
+
+    //priority of each vertex in the random order, ties broken by vertex id
+    uint64_t order_seed = mix_seed(seed);
+    auto forward = [&](int from, int to) {
+        uint64_t from_priority = mix_seed(order_seed ^ from);
+        uint64_t to_priority = mix_seed(order_seed ^ to);
+        return from_priority < to_priority || (from_priority == to_priority && from < to);
+    };
+
+    int block_count = (vertex_count + CIRCUIT_FILE_BLOCK_SIZE - 1) / CIRCUIT_FILE_BLOCK_SIZE;
+    std::atomic<int> next_block(0);
+    int written_blocks = 0;
+    std::mutex writer_mutex;
+    std::condition_variable block_written;
+
+    auto worker = [&]() {
+        std::vector<Vertex> block_vertices;
+        std::vector<Edge> block_edges;
+        for (int b = next_block++; b < block_count; b = next_block++) {
+            int first = b * CIRCUIT_FILE_BLOCK_SIZE;
+            int last = std::min(vertex_count, first + CIRCUIT_FILE_BLOCK_SIZE);
+            RandomCalculator rand(edge_u, edge_phi, mix_seed(((uint64_t) seed << 32) ^ b));
+
+            block_vertices.clear();
+            block_edges.clear();
+
+            auto add_edge_v = [&](int from, int to) {
+                int weight = rand.edge_weight();
+                if(weight == 0 && !forward(from, to)) weight = rand.positive_edge_weight();
+                block_edges.push_back(Edge(from, to, weight));
+            };
+
+            for (int v = first; v < last; ++v) {
+                block_vertices.push_back(Vertex(rand.vertex_weight()));
+            }
+
+            // Random tree: v is connected to a previous vertex
+            for (int v = std::max(first, 1); v < last; ++v) {
+                std::uniform_int_distribution<int> parent_dis(0, v-1);
+                int u = parent_dis(rand.gen);
+                if(rand.edge() < 0.5) add_edge_v(u, v);
+                else add_edge_v(v, u);
             }
-            std::cout << "\n";
-        }
-#endif
 
-        // We could be rerolling more than necessary if the same edge is in two different cycles.
-        // Since these cycles are rare and the graph is random, this doesn't really matter.
-        for(int i = 0; i < cycle_count; ++i) {
-            // Reroll weight of a random edge in the cycle
-            int e = rand.uniform(0, cycles[i].size()-0.01);
-            int weight = rand.edge_weight();
-            while(weight == 0) { // Make sure weight > 0
-                weight = rand.edge_weight();
+            // Random edges from the vertices of the block, skipping over the pairs as generate_circuit
+            long long pair_begin = (long long) first * (vertex_count-1);
+            long long pair_end = (long long) last * (vertex_count-1);
+            for (long long k = pair_begin + rand.skip(edge_p); k < pair_end; k += 1 + rand.skip(edge_p)) {
+                int i = k / (vertex_count-1);
+                int j = k % (vertex_count-1);
+                if(j >= i) ++j;
+                add_edge_v(i, j);
             }
-            cycles[i][e]->weight = weight;
+
+            //write blocks in order
+            std::unique_lock<std::mutex> lock(writer_mutex);
+            block_written.wait(lock, [&]() { return written_blocks == b; });
+            writer.write_vertices(first, block_vertices.data(), block_vertices.size());
+            writer.append_edges(block_edges.data(), block_edges.size());
+            ++written_blocks;
+            block_written.notify_all();
 
 #ifdef CIRCUITGENDEBUG
-            Edge *edge = cycles[i][e];
-            printf("Rerolled (%d, %d, [0 -> %d]) \n", edge->from, edge->to, edge->weight);
+            printf("Written block %d: vertices %d - %d, %d edges\n", b, first, last, (int) block_edges.size());
 #endif
         }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; ++t) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::thread &thread: threads) {
+        thread.join();
     }
 
-    return graph;
+    return writer.close();
 }
 
-
 #ifdef CIRCUITGENDEBUG
 int main_gen() {
     Graph graph = generate_circuit(10);
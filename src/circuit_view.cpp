@@ -0,0 +1,471 @@
+#ifndef CIRCUITVIEW
+#define CIRCUITVIEW
+
+#include <vector>
+#include <queue>
+#include <set>
+#include <algorithm>
+#include "types.h"
+#include "wd.cpp"
+#include "cycle_ratio.cpp"
+#include "parallel_bellman.cpp"
+#include "instrument.cpp"
+
+//#define CIRCUITVIEWDEBUG
+
+#ifdef CIRCUITVIEWDEBUG
+#include <iostream>
+#endif
+
+/**
+ * Non-owning view of a circuit stored by the caller as separate arrays (structure of arrays).
+ * Nothing is copied: the algorithms below read the arrays in place and write retimings into caller buffers.
+ * They take the same Instrument policies as their Graph counterparts (see instrument.cpp).
+ * delays: vertex_count vertex delays d(v).
+ * from, to, weight: edge_count edge sources, targets and register counts w(e).
+ */
+struct CircuitView {
+    const int *delays;
+    int vertex_count;
+    const int *from;
+    const int *to;
+    const int *weight;
+    int edge_count;
+};
+
+struct ViewResult {
+    bool r; //retiming found
+    int c; //clock period of the retiming written into r
+};
+
+//Registers of edge e after retiming r (null r is no retiming): wr(e) = w(e) + r(v) - r(u)
+inline int view_retimed_weight(CircuitView &view, const int *r, int e) {
+    return r ? view.weight[e] + r[view.to[e]] - r[view.from[e]] : view.weight[e];
+}
+
+//Out edges of each vertex: the ones of v are edge_ids[offsets[v]] to edge_ids[offsets[v+1]-1]
+struct ViewIndex {
+    std::vector<int> offsets;
+    std::vector<int> edge_ids;
+
+    ViewIndex(CircuitView &view): offsets(view.vertex_count+1, 0), edge_ids(view.edge_count) {
+        for (int e = 0; e < view.edge_count; ++e) {
+            ++offsets[view.from[e]+1];
+        }
+        for (int v = 0; v < view.vertex_count; ++v) {
+            offsets[v+1] += offsets[v];
+        }
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int e = 0; e < view.edge_count; ++e) {
+            edge_ids[position[view.from[e]]++] = e;
+        }
+    }
+};
+
+/**
+ * CP ALGORITHM over a view, with Kahn's topological order of the 0 weight edges.
+ * r: retiming to apply to the edges on the fly, null for none.
+ * deltas: array of vertex_count size where the deltas are stored.
+ * Returns the clock period, -1 if the (retimed) circuit has a 0 weight cycle. O(V + E).
+ */
+template<typename Instrument = NoInstrument>
+int view_cp(CircuitView &view, ViewIndex &index, const int *r, int *deltas) {
+    Instrument::enter("view_cp");
+    Instrument::count(TRACE_CP_CALLS, 1);
+    int vertex_count = view.vertex_count;
+    std::vector<int> in_degree(vertex_count, 0);
+    for (int e = 0; e < view.edge_count; ++e) {
+        if(view_retimed_weight(view, r, e) == 0) ++in_degree[view.to[e]];
+    }
+
+    std::vector<int> ready;
+    Instrument::allocated(sizeof(int) * 2 * vertex_count, false, INT, "in degrees and ready vertices");
+    for (int v = 0; v < vertex_count; ++v) {
+        deltas[v] = 0;
+        if(in_degree[v] == 0) ready.push_back(v);
+    }
+
+    int c = 0;
+    int sorted = 0;
+    while(!ready.empty()) {
+        int u = ready.back();
+        ready.pop_back();
+        ++sorted;
+        deltas[u] += view.delays[u];
+        if(deltas[u] > c) c = deltas[u];
+        for (int i = index.offsets[u]; i < index.offsets[u+1]; ++i) {
+            int e = index.edge_ids[i];
+            if(view_retimed_weight(view, r, e) != 0) continue;
+            int v = view.to[e];
+            if(deltas[u] > deltas[v]) deltas[v] = deltas[u];
+            if(--in_degree[v] == 0) ready.push_back(v);
+        }
+    }
+
+    Instrument::leave();
+
+    return sorted == vertex_count ? c : -1;
+}
+
+template<typename Instrument = NoInstrument>
+int view_cp(CircuitView &view, const int *r, int *deltas) {
+    ViewIndex index(view);
+    return view_cp<Instrument>(view, index, r, deltas);
+}
+
+/**
+ * FEAS ALGORITHM over a view, starting from the retiming in r instead of r = 0.
+ * Running FEAS on the circuit retimed by r, so it finds a retiming with clock period <= target_c if there is one, and
+ * from a retiming close to the result it is done in a few iterations.
+ * r: array of vertex_count size with a legal retiming (no negative edge), where the retiming is written.
+ * deltas: array of vertex_count size to calculate CP.
+ * Returns a ViewResult, r = false if target_c was not reached.
+ */
+template<typename Instrument = NoInstrument>
+ViewResult view_feas_from(CircuitView &view, ViewIndex &index, int target_c, int *r, int *deltas) {
+    Instrument::enter("view_feas");
+    int vertex_count = view.vertex_count;
+    bool changed = true;
+    for (int i = 1; i < vertex_count && changed; ++i) {
+        Instrument::count(TRACE_FEAS_ITERATIONS, 1);
+        changed = false;
+        view_cp<Instrument>(view, index, r, deltas);
+        for (int v = 0; v < vertex_count; ++v) {
+            if(deltas[v] > target_c) {
+                changed = true;
+                ++r[v];
+            }
+        }
+    }
+
+    int c = view_cp<Instrument>(view, index, r, deltas);
+    Instrument::leave();
+    return { c >= 0 && c <= target_c, c };
+}
+
+/**
+ * FEAS ALGORITHM over a view.
+ * r: array of vertex_count size where the retiming is written.
+ * deltas: array of vertex_count size to calculate CP.
+ * Returns a ViewResult, r = false if target_c was not reached.
+ */
+template<typename Instrument = NoInstrument>
+ViewResult view_feas(CircuitView &view, ViewIndex &index, int target_c, int *r, int *deltas) {
+    for (int v = 0; v < view.vertex_count; ++v) {
+        r[v] = 0;
+    }
+    return view_feas_from<Instrument>(view, index, target_c, r, deltas);
+}
+
+template<typename Instrument = NoInstrument>
+ViewResult view_feas(CircuitView &view, int target_c, int *r, int *deltas) {
+    ViewIndex index(view);
+    return view_feas<Instrument>(view, index, target_c, r, deltas);
+}
+
+//Rows of the given sources of the WD matrix, as view_wd writes them. Returns false if the circuit has a 0 weight cycle.
+template<typename Instrument = NoInstrument>
+bool view_wd_rows(CircuitView &view, ViewIndex &index, std::vector<int> &sources, WDEntry *WD) {
+    Instrument::enter("view_wd_rows");
+    int vertex_count = view.vertex_count;
+
+    std::vector<int> arrival(vertex_count);
+    if(view_cp<Instrument>(view, index, nullptr, &arrival[0]) < 0) {
+        Instrument::leave();
+        return false;
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        arrival[v] -= view.delays[v];
+    }
+
+    //reweighted distances: (registers, -delay + a(v) - a(u)), both non negative
+    typedef std::pair<std::pair<long long, long long>, int> HeapEntry;
+    std::vector<long long> registers(vertex_count);
+    std::vector<long long> delay(vertex_count);
+    std::vector<bool> done(vertex_count);
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    Instrument::allocated(sizeof(int) * vertex_count + sizeof(long long) * 2 * vertex_count + vertex_count / 8, false, INT,
+            "arrivals, distances and done");
+
+    for (int s: sources) {
+        std::fill(registers.begin(), registers.end(), -1);
+        std::fill(done.begin(), done.end(), false);
+        registers[s] = 0;
+        delay[s] = 0;
+        heap.push({{0, 0}, s});
+
+        while(!heap.empty()) {
+            HeapEntry top = heap.top();
+            heap.pop();
+            int u = top.second;
+            if(done[u]) continue;
+            done[u] = true;
+            for (int i = index.offsets[u]; i < index.offsets[u+1]; ++i) {
+                int e = index.edge_ids[i];
+                int v = view.to[e];
+                long long v_registers = registers[u] + view.weight[e];
+                long long v_delay = delay[u] - view.delays[u] + arrival[v] - arrival[u];
+                if(registers[v] < 0 || v_registers < registers[v] || (v_registers == registers[v] && v_delay < delay[v])) {
+                    registers[v] = v_registers;
+                    delay[v] = v_delay;
+                    heap.push({{v_registers, v_delay}, v});
+                }
+            }
+        }
+
+        //undo the reweighting: D(s, v) = d(v) + delay of the path before v
+        WDEntry *row = &WD[(long long) s * vertex_count];
+        for (int v = 0; v < vertex_count; ++v) {
+            if(registers[v] < 0) {
+                row[v] = {MAXINT, view.delays[v] - MAXINT};
+            } else {
+                row[v] = {(int) registers[v], (int) (view.delays[v] - (delay[v] - arrival[v] + arrival[s]))};
+            }
+        }
+    }
+
+    Instrument::leave();
+
+    return true;
+}
+
+/**
+ * WD ALGORITHM over a view, without building any graph.
+ * Johnson with lexicographic (w(e), -d(u)) edge weights: the arrival time a(v) = delta(v) - d(v) given by CP is
+ * a potential that makes every reweighted edge non negative (0 weight edges satisfy a(v) >= a(u) + d(u),
+ * the rest have w(e) > 0), so a Dijkstra from each vertex is enough, without Bellman-Ford.
+ * WD: array of vertex_count * vertex_count entries where the matrix is written, same values as wd
+ * (W = MAXINT and D = d(v) - MAXINT for unreachable pairs).
+ * Returns false if the circuit has a 0 weight cycle. O(V * E * log(V)).
+ */
+template<typename Instrument = NoInstrument>
+bool view_wd(CircuitView &view, WDEntry *WD) {
+    Instrument::enter("view_wd");
+    ViewIndex index(view);
+    std::vector<int> sources(view.vertex_count);
+    for (int s = 0; s < view.vertex_count; ++s) {
+        sources[s] = s;
+    }
+    bool r = view_wd_rows<Instrument>(view, index, sources, WD);
+    Instrument::leave();
+    return r;
+}
+
+/**
+ * Different D(u, v) values >= lower_bound in increasing order, the candidates for the minimized clock period.
+ * O(V^2), see wd_c_candidates.
+ */
+template<typename Instrument = NoInstrument>
+std::vector<int> view_c_candidates(CircuitView &view, WDEntry *WD, int lower_bound) {
+    return wd_c_candidates<Instrument>(WD, (long long) view.vertex_count * view.vertex_count, lower_bound);
+}
+
+//MAXIMUM CYCLE RATIO ALGORITHM over a view, see max_cycle_ratio. The circuit must not have 0 weight cycles.
+template<typename Instrument = NoInstrument>
+CycleRatioResult view_max_cycle_ratio(CircuitView &view) {
+    return max_cycle_ratio<Instrument>(view.vertex_count, view.edge_count, [&](int v) { return view.delays[v]; },
+            [&](int e) { return Edge(view.from[e], view.to[e], view.weight[e]); });
+}
+
+//Lower bound of the clock period of any retiming of the view, see period_lower_bound
+template<typename Instrument = NoInstrument>
+int view_period_lower_bound(CircuitView &view) {
+    return view_max_cycle_ratio<Instrument>(view).lower_bound;
+}
+
+/**
+ * Bellman-Ford (queue based) over difference constraints, each arc x -> y with weight b being r(y) - r(x) <= b.
+ * Every vertex starts at distance 0, as if reached from a virtual root.
+ * A vertex can be relaxed many times before it is dequeued, so relaxations say nothing about cycles: the arcs of the
+ * path behind each distance are counted instead, and a path of vertex_count arcs repeats a vertex, whose distance
+ * went down in between, so it goes around a negative cycle.
+ * Returns false if there is a negative cycle.
+ */
+template<typename Instrument = NoInstrument>
+bool view_bellman(int vertex_count, std::vector<Edge> &arcs, int *distance) {
+    Instrument::enter("view_bellman");
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (Edge &arc: arcs) {
+        ++offsets[arc.from+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> arc_ids(arcs.size());
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int a = 0; a < (int) arcs.size(); ++a) {
+            arc_ids[position[arcs[a].from]++] = a;
+        }
+    }
+
+    std::vector<int> path_arcs(vertex_count, 0);
+    std::vector<bool> queued(vertex_count, true);
+    std::queue<int> queue;
+    Instrument::allocated(sizeof(int) * (3 * vertex_count + 1 + arcs.size()) + vertex_count / 8, false, INT,
+            "arcs by source, path arcs, queue");
+    long long relaxations = 0;
+    bool r = true;
+    for (int v = 0; v < vertex_count; ++v) {
+        distance[v] = 0;
+        queue.push(v);
+    }
+    while(r && !queue.empty()) {
+        int x = queue.front();
+        queue.pop();
+        queued[x] = false;
+        for (int i = offsets[x]; i < offsets[x+1]; ++i) {
+            Edge &arc = arcs[arc_ids[i]];
+            if(distance[x] + arc.weight < distance[arc.to]) {
+                ++relaxations;
+                distance[arc.to] = distance[x] + arc.weight;
+                path_arcs[arc.to] = path_arcs[x] + 1;
+                if(path_arcs[arc.to] >= vertex_count) {
+                    r = false;
+                    break;
+                }
+                if(!queued[arc.to]) {
+                    queued[arc.to] = true;
+                    queue.push(arc.to);
+                }
+            }
+        }
+    }
+    Instrument::count(TRACE_BELLMAN_RELAXATIONS, relaxations);
+    Instrument::leave();
+    return r;
+}
+
+/**
+ * OPT1 ALGORITHM over a view: binary search of the candidates, solving the 7.1 and 7.2 constraints with Bellman-Ford.
+ * WD: matrix as written by view_wd (or wd).
+ * c_candidates: candidates in increasing order, as given by view_c_candidates.
+ * r: array of vertex_count size where the retiming of the minimized clock period is written.
+ * thread_count: above 1 the constraints are solved by bellman_parallel with that many threads, else by view_bellman.
+ * Returns a ViewResult.
+ */
+template<typename Instrument = NoInstrument>
+ViewResult view_opt1(CircuitView &view, WDEntry *WD, std::vector<int> &c_candidates, int *r, int thread_count = 1) {
+    Instrument::enter("view_opt1");
+    int vertex_count = view.vertex_count;
+
+    //7.1: r(u) - r(v) <= w(e)
+    std::vector<Edge> arcs;
+    for (int e = 0; e < view.edge_count; ++e) {
+        arcs.push_back(Edge(view.to[e], view.from[e], view.weight[e]));
+    }
+    //one more for the root of bellman_parallel
+    std::vector<int> distance(vertex_count+1);
+    Instrument::allocated(sizeof(int) * (vertex_count+1), false, INT, "distances");
+
+    int c = -1;
+    int bot = 0;
+    int top = c_candidates.size()-1;
+    while(bot <= top) {
+        int b = (top + bot)/2;
+        int current_c = c_candidates[b];
+        Instrument::probe_start();
+
+        //7.2: r(u) - r(v) <= W(u, v) - 1 for D(u, v) > c
+        Instrument::enter("7.2 edges");
+        for (int u = 0; u < vertex_count; ++u) {
+            WDEntry *row = &WD[(long long) u * vertex_count];
+            for (int v = 0; v < vertex_count; ++v) {
+                if(row[v].D > current_c && row[v].D - view.delays[u] <= current_c && row[v].D - view.delays[v] <= current_c)
+                    arcs.push_back(Edge(v, u, row[v].W - 1));
+            }
+        }
+        Instrument::count(TRACE_CONSTRAINT_EDGES, arcs.size() - view.edge_count);
+        Instrument::leave();
+
+        bool found;
+        if(thread_count > 1) {
+            Graph constraints(nullptr, arcs.data(), vertex_count, arcs.size());
+            found = bellman_parallel<Instrument>(constraints, &distance[0], thread_count);
+        } else {
+            found = view_bellman<Instrument>(vertex_count, arcs, &distance[0]);
+        }
+        arcs.erase(arcs.begin() + view.edge_count, arcs.end());
+        Instrument::probe("view_opt1", b, bot, top, current_c, found, current_c);
+
+        if(found) {
+            c = current_c;
+            top = b - 1;
+            for (int v = 0; v < vertex_count; ++v) {
+                r[v] = distance[v];
+            }
+        } else {
+            bot = b + 1;
+        }
+
+#ifdef CIRCUITVIEWDEBUG
+        printf("[View OPT1] c: %d\tfound: %d\n", current_c, found);
+#endif
+    }
+
+    Instrument::leave();
+
+    return { c >= 0, c };
+}
+
+//OPT1 over a view, candidates below the lower bound of view_period_lower_bound are not probed
+template<typename Instrument = NoInstrument>
+ViewResult view_opt1(CircuitView &view, WDEntry *WD, int *r, int thread_count = 1) {
+    std::vector<int> c_candidates = view_c_candidates<Instrument>(view, WD, view_period_lower_bound<Instrument>(view));
+    return view_opt1<Instrument>(view, WD, c_candidates, r, thread_count);
+}
+
+/**
+ * OPT2 ALGORITHM over a view: binary search of the candidates with FEAS.
+ * FEAS may reach a clock period below the probed candidate, the candidates down to that clock period are skipped.
+ * c_candidates: candidates in increasing order, as given by view_c_candidates.
+ * r: array of vertex_count size where the retiming of the minimized clock period is written.
+ * Returns a ViewResult.
+ */
+template<typename Instrument = NoInstrument>
+ViewResult view_opt2(CircuitView &view, std::vector<int> &c_candidates, int *r) {
+    Instrument::enter("view_opt2");
+    int vertex_count = view.vertex_count;
+    ViewIndex index(view);
+    std::vector<int> tmp_r(vertex_count);
+    std::vector<int> deltas(vertex_count);
+    Instrument::allocated(sizeof(int) * (2 * vertex_count + vertex_count+1 + view.edge_count), false, INT,
+            "index, retiming and deltas");
+
+    int c = -1;
+    int bot = 0;
+    int top = c_candidates.size()-1;
+    while(bot <= top) {
+        int b = (top + bot)/2;
+        Instrument::probe_start();
+        ViewResult feas_result = view_feas<Instrument>(view, index, c_candidates[b], &tmp_r[0], &deltas[0]);
+        Instrument::probe("view_opt2", b, bot, top, c_candidates[b], feas_result.r, feas_result.c);
+        if(feas_result.r) {
+            c = feas_result.c;
+            while(b > 0 && c_candidates[b] > c) {
+                b--;
+            }
+            top = b - 1;
+            std::copy(tmp_r.begin(), tmp_r.end(), r);
+        } else {
+            bot = b + 1;
+        }
+
+#ifdef CIRCUITVIEWDEBUG
+        printf("[View OPT2] c: %d\tfound: %d\tresult c: %d\n", c_candidates[b], feas_result.r, feas_result.c);
+#endif
+    }
+
+    Instrument::leave();
+
+    return { c >= 0, c };
+}
+
+//OPT2 over a view, candidates below the lower bound of view_period_lower_bound are not probed
+template<typename Instrument = NoInstrument>
+ViewResult view_opt2(CircuitView &view, WDEntry *WD, int *r) {
+    std::vector<int> c_candidates = view_c_candidates<Instrument>(view, WD, view_period_lower_bound<Instrument>(view));
+    return view_opt2<Instrument>(view, c_candidates, r);
+}
+
+#endif
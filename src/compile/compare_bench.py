@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Compares two performance_bench_main JSON results (--benchmark_out_format=json).
+# Usage: compare_bench.py baseline.json contender.json [--threshold 0.05] [--metric real_time|cpu_time]
+# A benchmark regresses when its time grows by more than the threshold; the exit code is 1 if any does.
+# With repetitions, the mean aggregate is compared; BigO and RMS rows are skipped.
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+def load(path):
+    with open(path) as file:
+        data = json.load(file)
+    runs = {}
+    for run in data['benchmarks']:
+        if run.get('run_type') == 'aggregate':
+            if run.get('aggregate_name') != 'mean':
+                continue
+            name = run['run_name']
+        else:
+            name = run['name']
+            if name in runs:
+                continue  # repetition, the mean aggregate replaces it
+        if 'time_unit' in run:
+            runs[name] = run
+    return data.get('context', {}), runs
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('baseline')
+    parser.add_argument('contender')
+    parser.add_argument('--threshold', type=float, default=0.05, help='relative change flagged (default 0.05)')
+    parser.add_argument('--metric', default='real_time', choices=['real_time', 'cpu_time'])
+    args = parser.parse_args()
+
+    base_context, base = load(args.baseline)
+    new_context, new = load(args.contender)
+    for key in ('fixture_seed', 'fixture_dir'):
+        if base_context.get(key) != new_context.get(key):
+            print('warning: %s differs (%s vs %s), the graphs may not be the same' % (key, base_context.get(key), new_context.get(key)))
+
+    regressions = 0
+    improvements = 0
+    print('%-45s %14s %14s %9s' % ('benchmark', 'baseline ns', 'contender ns', 'change'))
+    for name, run in base.items():
+        if name not in new:
+            continue
+        before = run[args.metric] * TIME_UNITS[run['time_unit']]
+        after = new[name][args.metric] * TIME_UNITS[new[name]['time_unit']]
+        change = (after - before) / before if before > 0 else 0.0
+        flag = ''
+        if change > args.threshold:
+            flag = 'REGRESSION'
+            regressions += 1
+        elif change < -args.threshold:
+            flag = 'improvement'
+            improvements += 1
+        print('%-45s %14.1f %14.1f %+8.1f%% %s' % (name, before, after, change * 100, flag))
+
+    missing = [name for name in base if name not in new]
+    added = [name for name in new if name not in base]
+    if missing:
+        print('only in baseline: %s' % ', '.join(missing))
+    if added:
+        print('only in contender: %s' % ', '.join(added))
+    print('%d regressions, %d improvements (threshold %.1f%%)' % (regressions, improvements, args.threshold * 100))
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
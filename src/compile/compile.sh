@@ -5,4 +5,6 @@
 #g++ -I ../boost_1_73_0 -g -o3 feas.cpp -o ../build/main
 #g++ -I ../boost_1_73_0 -g -o3 cycle_finder.cpp -o ../build/main
 #g++ -I ../boost_1_73_0 -g -o3 circuit_generator.cpp -o ../build/main
-g++ -I ../boost_1_73_0 -g -o3 main.cpp -o ../build/main
+g++ -I ../boost_1_73_0 -g -o3 -pthread main.cpp -o ../build/main
+g++ -I ../boost_1_73_0 -o3 -pthread batch_main.cpp -o ../build/batch_main
+g++ -I ../boost_1_73_0 -o3 -pthread service_main.cpp -o ../build/service_main
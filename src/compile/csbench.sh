@@ -1,2 +1,4 @@
-g++ -I ../boost_1_73_0 -g -o3 space_bench_main.cpp -o ../build/space_bench_main
+g++ -I ../boost_1_73_0 -g -o3 -pthread space_bench_main.cpp -o ../build/space_bench_main
 ../build/space_bench_main
+g++ -I ../boost_1_73_0 -o3 -pthread heap_bench_main.cpp -o ../build/heap_bench_main
+../build/heap_bench_main
@@ -10,6 +10,8 @@
 #include <set>
 #include <queue>
 #include "types.h"
+#include "trace.cpp"
+#include "instrument.cpp"
 
 //#define CPDEBUG
 
@@ -24,10 +26,10 @@
  * deltas array has to be of length = vertex_count
  * Returns an array of deltas in vertex order.
  */
+template<typename Instrument = NoInstrument>
 int cp(Graph &graph, int *deltas) {
-#ifdef SPACEBENCH
-    space_bench->push_stack();
-#endif
+    Instrument::enter("cp");
+    Instrument::count(TRACE_CP_CALLS, 1);
     using namespace boost;
     typedef adjacency_list<vecS, vecS, directedS> BGLGraph;
     typedef boost::graph_traits<BGLGraph>::vertex_descriptor BGLVertex;
@@ -56,16 +58,14 @@ int cp(Graph &graph, int *deltas) {
     std::vector<BGLVertex> sorted_vertices(vertex_count);
     topological_sort(g, std::back_inserter(sorted_vertices));
 
-#ifdef SPACEBENCH
-    space_bench->allocated(sizeof(int) * graph.vertex_count, false, BGLVERTEX, "BGL graph vertices");
-    space_bench->allocated(sizeof(int) * 2 * graph.edge_count, false, BGLEDGE, "BGL graph edges");
+    Instrument::allocated(sizeof(int) * graph.vertex_count, false, BGLVERTEX, "BGL graph vertices");
+    Instrument::allocated(sizeof(int) * 2 * graph.edge_count, false, BGLEDGE, "BGL graph edges");
     int dependencies_size = 0;
     for (int i = 0; i < vertex_count; ++i) {
         dependencies_size += dependencies[i].size();
     }
-    space_bench->allocated(sizeof(int) * dependencies_size, false, INT, "dependencies");
-    space_bench->allocated(sizeof(int) * graph.vertex_count, false, INT, "topologically sorted vertices");
-#endif
+    Instrument::allocated(sizeof(int) * dependencies_size, false, INT, "dependencies");
+    Instrument::allocated(sizeof(int) * graph.vertex_count, false, INT, "topologically sorted vertices");
 
     int c = 0; //clock period (max delta)
 
@@ -88,9 +88,7 @@ int cp(Graph &graph, int *deltas) {
 #endif
     }
 
-#ifdef SPACEBENCH
-    space_bench->pop_stack();
-#endif
+    Instrument::leave();
 
     return c;     
 }
@@ -1,9 +1,9 @@
 #ifndef CYCLEFINDER
 #define CYCLEFINDER
 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/hawick_circuits.hpp>
 #include <vector>
+#include <algorithm>
+#include <string>
 #include "types.h"
 
 //#define CYCLEFINDERDEBUG
@@ -11,86 +11,158 @@
 #include <iostream>
 #endif
 
-
-struct cycle_visitor
-{
-    std::vector<std::vector<Edge *>> *cycles;
-    Edge *edges;
-    int edge_count;
-
-    cycle_visitor(std::vector<std::vector<Edge *>> *cycles, Edge *edges, int edge_count){
-        this->edges = edges; 
-        this->edge_count = edge_count;
-        this->cycles = cycles;
+/**
+ * ZERO WEIGHT CYCLE FINDER
+ * Every 0 weight cycle lies inside a strongly connected component of the subgraph of 0 weight edges
+ * with more than one vertex (or with a 0 weight self loop), and every such component has one.
+ * Finds the components with an iterative Tarjan over a CSR index of the 0 weight edges, then a witness cycle
+ * in each of them with a BFS restricted to the component, back to its first vertex.
+ * O(V + E), unlike enumerating every elementary circuit.
+ * cycles: Vector where one 0 weight cycle (as pointers to the graph edges, in path order) is stored per component.
+ */
+void find_zero_weight_cycles(std::vector<std::vector<Edge *>> *cycles, Graph &graph) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    //0 weight edges of each vertex, by source
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        if(edges[i].weight == 0) ++offsets[edges[i].from+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> zero_edges(offsets[vertex_count]);
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int i = 0; i < edge_count; ++i) {
+            if(edges[i].weight == 0) zero_edges[position[edges[i].from]++] = i;
+        }
     }
 
-    template <typename Path, typename Graph>
-    void cycle(Path const& p, Graph const& g) {
-        using namespace boost;
-        if (p.empty())
-            return;
-
-        // Get the property map containing the vertex indices
-        typedef typename boost::property_map<Graph, boost::vertex_index_t>::const_type IndexMap;
-
-        IndexMap indices = get(boost::vertex_index, g);
-
-        int cycle_length = p.size();
-
-        std::vector<Edge *> cycle(cycle_length);
-
-        // Check if the cycle edges are weight 0
-        int u = get(indices, p[cycle_length-1]);
-        int v;
-        for(int i = 0; i < cycle_length; ++i) {
-            v = get(indices, p[i]);
-
-            // Check if there is at least one 0 weight edge between the vertices
-            // This is not optimized at all 
-            bool zero_edge = false;
-            for(int j = 0; j < edge_count; ++j) {
-                Edge edge = edges[j];
-
-                if(edge.from == u && edge.to == v) {
-                    if(edge.weight == 0) {
-                        zero_edge = true;
-                        cycle[i] = &edges[j];
 #ifdef CYCLEFINDERDEBUG
-                        printf("Adding %d, %d [%d]\n", edge.from, edge.to, edge.weight);
+    printf("Checking cycles in graph with %d 0-weight edges\n", offsets[vertex_count]);
 #endif
-                    }
+
+    //Tarjan's strongly connected components, iterative so long 0 weight chains cannot overflow the stack
+    std::vector<int> index(vertex_count, -1);
+    std::vector<int> low(vertex_count);
+    std::vector<int> component(vertex_count, -1);
+    std::vector<int> next_edge(vertex_count);
+    std::vector<int> stack;
+    std::vector<int> call_stack;
+    int next_index = 0;
+    int component_count = 0;
+    std::vector<int> component_root; //first vertex of each nontrivial component
+
+    for (int s = 0; s < vertex_count; ++s) {
+        if(index[s] >= 0) continue;
+
+        index[s] = low[s] = next_index++;
+        next_edge[s] = offsets[s];
+        stack.push_back(s);
+        call_stack.push_back(s);
+
+        while(!call_stack.empty()) {
+            int v = call_stack.back();
+            if(next_edge[v] < offsets[v+1]) {
+                int w = edges[zero_edges[next_edge[v]++]].to;
+                if(index[w] < 0) {
+                    index[w] = low[w] = next_index++;
+                    next_edge[w] = offsets[w];
+                    stack.push_back(w);
+                    call_stack.push_back(w);
+                } else if(component[w] < 0) {
+                    low[v] = std::min(low[v], index[w]);
                 }
+                continue;
+            }
+
+            call_stack.pop_back();
+            if(!call_stack.empty()) {
+                int parent = call_stack.back();
+                low[parent] = std::min(low[parent], low[v]);
             }
-            if(!zero_edge) return;
+            if(low[v] != index[v]) continue;
+
+            //v is the root of a component
+            int size = 0;
+            int w;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                component[w] = component_count;
+                ++size;
+            } while(w != v);
+
+            bool nontrivial = size > 1;
+            for (int i = offsets[v]; i < offsets[v+1] && !nontrivial; ++i) {
+                if(edges[zero_edges[i]].to == v) nontrivial = true;
+            }
+            if(nontrivial) component_root.push_back(v);
+            ++component_count;
+        }
+    }
 
-            u = v;
+    //Witness cycle of each nontrivial component: BFS from its root until an edge gets back to it
+    std::vector<int> parent_edge(vertex_count, -1);
+    std::vector<int> queue;
+    for (int root: component_root) {
+        int c = component[root];
+        int closing_edge = -1;
+        queue.clear();
+        queue.push_back(root);
+        parent_edge[root] = -2;
+        for (int q = 0; q < (int) queue.size() && closing_edge < 0; ++q) {
+            int v = queue[q];
+            for (int i = offsets[v]; i < offsets[v+1]; ++i) {
+                int w = edges[zero_edges[i]].to;
+                if(w == root) {
+                    closing_edge = zero_edges[i];
+                    break;
+                }
+                if(component[w] != c || parent_edge[w] != -1) continue;
+                parent_edge[w] = zero_edges[i];
+                queue.push_back(w);
+            }
         }
 
-        // 0 weighted cycle
+        std::vector<Edge *> cycle;
+        for (int e = closing_edge; e >= 0; e = parent_edge[edges[e].from]) {
+            cycle.push_back(&edges[e]);
+        }
+        std::reverse(cycle.begin(), cycle.end());
         cycles->push_back(cycle);
+
+        for (int v: queue) {
+            parent_edge[v] = -1;
+        }
+
 #ifdef CYCLEFINDERDEBUG
-        printf("Added cycle: %d\n", (int) cycles->size());
+        printf("Added cycle: %d (length %d)\n", (int) cycles->size(), (int) cycle.size());
 #endif
     }
-};
+}
 
-void find_zero_weight_cycles(std::vector<std::vector<Edge *>> *cycles, Graph &graph) {
-    using namespace boost;
-    typedef adjacency_list<vecS, vecS, directedS, no_property, no_property> BGLGraph;
-    BGLGraph g(graph.vertex_count);
-    int edge_count = 0;
-    for(int i = 0; i < graph.edge_count; ++i) {
-        if(graph.edges[i].weight == 0) {
-            add_edge(graph.edges[i].from, graph.edges[i].to, g);
-            ++edge_count;
+/**
+ * Error message naming the vertices of a 0 weight cycle of the graph, "0 weight cycle 4 -> 7 -> 4", for the circuits
+ * WD and OPT refuse. Long cycles are cut after max_vertices vertices.
+ */
+std::string zero_weight_cycle_message(Graph &graph, int max_vertices = 16) {
+    std::vector<std::vector<Edge *>> cycles;
+    find_zero_weight_cycles(&cycles, graph);
+    std::string message = "0 weight cycle";
+    if(cycles.empty()) return message;
+    std::vector<Edge *> &cycle = cycles[0];
+    for (int i = 0; i < (int) cycle.size(); ++i) {
+        if(i == max_vertices) {
+            message += " -> ... (" + std::to_string(cycle.size()) + " vertices)";
+            return message;
         }
+        message += (i == 0 ? " " : " -> ") + std::to_string(cycle[i]->from);
     }
-#ifdef CYCLEFINDERDEBUG
-        printf("Checking cycles in graph with %d 0-weight edges\n", edge_count);
-#endif
-
-    cycle_visitor visitor(cycles, graph.edges, graph.edge_count);
-    boost::hawick_circuits(g, visitor);
+    return message + " -> " + std::to_string(cycle[0]->from);
 }
 
 #ifdef CYCLEFINDERDEBUG
@@ -0,0 +1,96 @@
+#ifndef CYCLERATIO
+#define CYCLERATIO
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/howard_cycle_ratio.hpp>
+#include <vector>
+#include "types.h"
+#include "trace.cpp"
+#include "instrument.cpp"
+
+//#define CYCLERATIODEBUG
+
+#ifdef CYCLERATIODEBUG
+#include <iostream>
+#endif
+
+struct CycleRatioResult {
+    double ratio; //maximum over cycles of delay / registers, 0 if the graph has no cycles
+    int delay; //total delay of the critical cycle
+    int registers; //total registers of the critical cycle
+    int lower_bound; //lower bound of the clock period of any retiming: max(ceil(delay / registers), max d(v))
+};
+
+/**
+ * MAXIMUM CYCLE RATIO ALGORITHM
+ * Retiming keeps the amount of registers of every cycle, so no retiming can have a clock period below
+ * ceil(delay / registers) of any cycle, nor below the delay of any vertex.
+ * Uses Howard's policy iteration (BGL maximum_cycle_ratio), nearly O(E) per iteration and without WD.
+ * The lower bound is computed exactly from the critical cycle, not from the floating point ratio.
+ * The circuit is read through delay_of(v), the delay of vertex v, and edge_of(i), the Edge i, so the same code runs
+ * over a Graph and over a CircuitView (see view_max_cycle_ratio).
+ * The circuit must not have 0 weight cycles.
+ * Returns a CycleRatioResult.
+ */
+template<typename Instrument, typename DelayOf, typename EdgeOf>
+CycleRatioResult max_cycle_ratio(int vertex_count, int edge_count, DelayOf delay_of, EdgeOf edge_of) {
+    Instrument::enter("max_cycle_ratio");
+    using namespace boost;
+    typedef adjacency_list<vecS, vecS, directedS, no_property, property<edge_weight_t, int, property<edge_weight2_t, int>>> BGLGraph;
+    typedef graph_traits<BGLGraph>::edge_descriptor BGLEdge;
+
+    //edge weight: delay of its source vertex, edge weight2: its registers
+    BGLGraph g(vertex_count);
+    for (int i = 0; i < edge_count; ++i) {
+        Edge edge = edge_of(i);
+        add_edge(edge.from, edge.to, property<edge_weight_t, int, property<edge_weight2_t, int>>(delay_of(edge.from), edge.weight), g);
+    }
+
+    Instrument::allocated(sizeof(int) * vertex_count, false, BGLVERTEX, "BGL graph vertices");
+    Instrument::allocated(sizeof(int) * 4 * edge_count, false, BGLEDGE, "BGL graph edges");
+
+    CycleRatioResult result = {0, 0, 0, 0};
+
+    for (int v = 0; v < vertex_count; ++v) {
+        if(delay_of(v) > result.lower_bound) result.lower_bound = delay_of(v);
+    }
+
+    std::vector<BGLEdge> critical_cycle;
+    double ratio = maximum_cycle_ratio(g, get(vertex_index, g), get(edge_weight, g), get(edge_weight2, g), &critical_cycle);
+
+    if(!critical_cycle.empty()) {
+        for (BGLEdge e: critical_cycle) {
+            result.delay += get(edge_weight, g, e);
+            result.registers += get(edge_weight2, g, e);
+        }
+        result.ratio = ratio;
+        int ratio_bound = (result.delay + result.registers - 1) / result.registers;
+        if(ratio_bound > result.lower_bound) result.lower_bound = ratio_bound;
+    }
+
+#ifdef CYCLERATIODEBUG
+    printf("Max cycle ratio: %f (%d / %d), lower bound: %d\n", result.ratio, result.delay, result.registers, result.lower_bound);
+#endif
+
+    Instrument::leave();
+
+    return result;
+}
+
+template<typename Instrument = NoInstrument>
+CycleRatioResult max_cycle_ratio(Graph &graph) {
+    Vertex *vertices = graph.vertices;
+    Edge *edges = graph.edges;
+    return max_cycle_ratio<Instrument>(graph.vertex_count, graph.edge_count, [&](int v) { return vertices[v].weight; },
+            [&](int i) { return edges[i]; });
+}
+
+/**
+ * Returns a lower bound of the clock period of any retiming of the graph, see max_cycle_ratio.
+ */
+template<typename Instrument = NoInstrument>
+int period_lower_bound(Graph &graph) {
+    return max_cycle_ratio<Instrument>(graph).lower_bound;
+}
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef ECOALG
+#define ECOALG
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include "types.h"
+#include "opt.cpp"
+#include "circuit_view.cpp"
+
+//#define ECODEBUG
+
+#ifdef ECODEBUG
+#include <iostream>
+#endif
+
+/**
+ * Incremental re-optimization after small edits (ECOs) of a circuit already optimized by opt1 or opt2.
+ * Instead of WD and a full binary search:
+ * - The WD matrix is repaired in place. Every shortest path is simple (cycles have at least one register), so an edit
+ *   changes only the paths through the edited vertex or edge: an edit making those paths better is a closed form
+ *   update of every pair, O(V^2), an edit making them worse recomputes only the entries with a shortest path through
+ *   it (see EcoRepair).
+ * - FEAS starts from the previous retiming (see view_feas_from), made legal again for the edited registers.
+ * - The candidates are searched outwards from the previous clock period (galloping), then by binary search between the
+ *   closest feasible and infeasible candidates.
+ */
+
+enum EcoEditType {
+    ECO_DELAY, //d(v) of vertex id
+    ECO_REGISTERS //w(e) of edge id
+};
+
+struct EcoEdit {
+    EcoEditType type;
+    int id; //vertex or edge
+    int value; //new delay or register count
+};
+
+struct EcoStats {
+    int repaired_rows; //WD rows with recomputed entries
+    long long repaired_entries; //WD entries recomputed
+    int probes; //FEAS runs
+};
+
+//(W1, D1) is a shorter WD path than (W2, D2): fewer registers, or as many with more delay
+inline bool eco_shorter(long long W1, long long D1, int W2, int D2) {
+    return W1 < W2 || (W1 == W2 && D1 > D2);
+}
+
+/**
+ * Recomputes the WD entries of a row whose shortest paths may have got longer, from the other entries of the row.
+ * The shortest path to an affected vertex leaves the last unaffected vertex on it (whose entry is right) by one of the
+ * in edges of the affected vertices, so a Dijkstra among the affected vertices only, seeded through those edges, finds
+ * it. Same reweighting as view_wd_rows, with the CP arrival times of the edited circuit as potentials.
+ * O(A * log(A) + edges of the A affected vertices) per row, instead of a Dijkstra over the whole circuit.
+ */
+struct EcoRepair {
+    CircuitView &view;
+    ViewIndex &index;
+    CircuitView reversed;
+    ViewIndex in_index; //in edges of each vertex, the out edges of the reversed circuit
+    std::vector<int> arrival;
+    std::vector<int> columns; //affected entries of the row being repaired
+    std::vector<char> affected;
+    std::vector<long long> registers;
+    std::vector<long long> delay;
+    std::vector<char> done;
+    EcoStats &stats;
+
+    EcoRepair(CircuitView &view, ViewIndex &index, EcoStats &stats): view(view), index(index),
+            reversed({ view.delays, view.vertex_count, view.to, view.from, view.weight, view.edge_count }), in_index(reversed),
+            arrival(view.vertex_count), affected(view.vertex_count, 0), registers(view.vertex_count),
+            delay(view.vertex_count), done(view.vertex_count), stats(stats) {}
+
+    //Arrival times of the circuit as it is now, to call once the edit is in view
+    void start() {
+        view_cp(view, index, nullptr, arrival.data());
+        for (int v = 0; v < view.vertex_count; ++v) {
+            arrival[v] -= view.delays[v];
+        }
+    }
+
+    //Recomputes the entries of row u listed in columns, and clears them
+    void repair_row(WDEntry *row, int u) {
+        if(columns.empty()) return;
+        typedef std::pair<std::pair<long long, long long>, int> HeapEntry;
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+        for (int v: columns) {
+            affected[v] = 1;
+            registers[v] = -1;
+            done[v] = 0;
+        }
+
+        //seeds: from the unaffected vertices, whose entries are right, (registers, -delay + a(v) - a(u))
+        for (int v: columns) {
+            for (int i = in_index.offsets[v]; i < in_index.offsets[v+1]; ++i) {
+                int e = in_index.edge_ids[i];
+                int w = view.from[e];
+                if(affected[w] || row[w].W == MAXINT) continue;
+                long long v_registers = (long long) row[w].W + view.weight[e];
+                long long v_delay = -(long long) row[w].D + arrival[v] - arrival[u];
+                if(registers[v] < 0 || v_registers < registers[v] || (v_registers == registers[v] && v_delay < delay[v])) {
+                    registers[v] = v_registers;
+                    delay[v] = v_delay;
+                }
+            }
+            if(registers[v] >= 0) heap.push({{registers[v], delay[v]}, v});
+        }
+
+        while(!heap.empty()) {
+            HeapEntry top = heap.top();
+            heap.pop();
+            int y = top.second;
+            if(done[y]) continue;
+            done[y] = 1;
+            for (int i = index.offsets[y]; i < index.offsets[y+1]; ++i) {
+                int e = index.edge_ids[i];
+                int z = view.to[e];
+                if(!affected[z]) continue;
+                long long z_registers = registers[y] + view.weight[e];
+                long long z_delay = delay[y] - view.delays[y] + arrival[z] - arrival[y];
+                if(registers[z] < 0 || z_registers < registers[z] || (z_registers == registers[z] && z_delay < delay[z])) {
+                    registers[z] = z_registers;
+                    delay[z] = z_delay;
+                    heap.push({{z_registers, z_delay}, z});
+                }
+            }
+        }
+
+        //undo the reweighting, as view_wd_rows
+        for (int v: columns) {
+            affected[v] = 0;
+            if(registers[v] < 0) {
+                row[v] = {MAXINT, view.delays[v] - MAXINT};
+            } else {
+                row[v] = {(int) registers[v], (int) (view.delays[v] - (delay[v] - arrival[v] + arrival[u]))};
+            }
+        }
+        ++stats.repaired_rows;
+        stats.repaired_entries += columns.size();
+        columns.clear();
+    }
+};
+
+/**
+ * Delay of vertex x changed from old_delay to d(x) (already in view).
+ * Paths through x keep their registers and their delay changes by the same amount.
+ */
+void eco_repair_delay(EcoRepair &repair, WDEntry *WD, int x, int old_delay) {
+    CircuitView &view = repair.view;
+    int vertex_count = view.vertex_count;
+    int diff = view.delays[x] - old_delay;
+    WDEntry *row_x = &WD[(long long) x * vertex_count];
+    if(diff < 0) repair.start();
+
+    for (int u = 0; u < vertex_count; ++u) {
+        WDEntry *row = &WD[(long long) u * vertex_count];
+        if(u != x && row[x].W != MAXINT) {
+            for (int v = 0; v < vertex_count; ++v) {
+                if(v == x || row_x[v].W == MAXINT) continue;
+                long long W = (long long) row[x].W + row_x[v].W;
+                long long D = (long long) row[x].D + row_x[v].D - old_delay;
+                if(diff > 0) {
+                    //paths through x got longer in delay, the best one may now be the shortest
+                    if(eco_shorter(W, D + diff, row[v].W, row[v].D)) row[v] = {(int) W, (int) (D + diff)};
+                } else if(W == row[v].W && D == row[v].D) {
+                    //the shortest path went through x and got shorter in delay, another one may be the shortest now
+                    repair.columns.push_back(v);
+                }
+            }
+        }
+        //every path to x ends at x, then the entries through x are recomputed from it
+        row[x].D += diff;
+        repair.repair_row(row, u);
+    }
+
+    //every path from x starts at x (row x is read by the other rows until here)
+    for (int v = 0; v < vertex_count; ++v) {
+        if(v != x && row_x[v].W != MAXINT) row_x[v].D += diff;
+    }
+}
+
+/**
+ * Registers of edge e = (a, b) changed from old_weight to w(e) (already in view).
+ * Paths through e keep their delay and their registers change by the same amount.
+ * Row b, read by the other rows, never goes through e (it would go around a cycle), so it is not changed.
+ */
+void eco_repair_registers(EcoRepair &repair, WDEntry *WD, int e, int old_weight) {
+    CircuitView &view = repair.view;
+    int vertex_count = view.vertex_count;
+    int a = view.from[e];
+    int b = view.to[e];
+    int weight = view.weight[e];
+    //a shortest path never goes around a cycle
+    if(a == b) return;
+    WDEntry *row_b = &WD[(long long) b * vertex_count];
+    if(weight > old_weight) repair.start();
+
+    for (int u = 0; u < vertex_count; ++u) {
+        WDEntry *row = &WD[(long long) u * vertex_count];
+        if(row[a].W == MAXINT) continue;
+        for (int v = 0; v < vertex_count; ++v) {
+            if(row_b[v].W == MAXINT) continue;
+            long long W = (long long) row[a].W + row_b[v].W;
+            long long D = (long long) row[a].D + row_b[v].D;
+            if(weight < old_weight) {
+                //paths through e have fewer registers, the best one may now be the shortest (never u -> a or b -> v, a cycle)
+                if(eco_shorter(W + weight, D, row[v].W, row[v].D)) row[v] = {(int) (W + weight), (int) D};
+            } else if(W + old_weight == row[v].W && D == row[v].D) {
+                //the shortest path went through e and got more registers, another one may be the shortest now
+                repair.columns.push_back(v);
+            }
+        }
+        repair.repair_row(row, u);
+    }
+}
+
+/**
+ * Makes r legal again after edits removed registers: raises r(v) until w(e) + r(v) - r(u) >= 0 for every edge,
+ * so only the vertices after the edited edges move. Bellman-Ford with a queue, as view_bellman.
+ */
+void eco_legalize(CircuitView &view, ViewIndex &index, int *r) {
+    int vertex_count = view.vertex_count;
+    std::vector<bool> queued(vertex_count, false);
+    std::queue<int> queue;
+    for (int e = 0; e < view.edge_count; ++e) {
+        if(view_retimed_weight(view, r, e) < 0 && !queued[view.from[e]]) {
+            queued[view.from[e]] = true;
+            queue.push(view.from[e]);
+        }
+    }
+    while(!queue.empty()) {
+        int u = queue.front();
+        queue.pop();
+        queued[u] = false;
+        for (int i = index.offsets[u]; i < index.offsets[u+1]; ++i) {
+            int e = index.edge_ids[i];
+            int v = view.to[e];
+            if(view_retimed_weight(view, r, e) < 0) {
+                r[v] = r[u] - view.weight[e];
+                if(!queued[v]) {
+                    queued[v] = true;
+                    queue.push(v);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Re-optimizes the clock period of a circuit after the given edits, from a previous optimization.
+ * graph: the circuit previous was computed on, the edits are applied to its vertices and edges.
+ * WD: WD matrix of graph, repaired in place to the one of the edited circuit.
+ * previous: result of opt1 or opt2 (or eco_reopt) on graph, not freed.
+ * edits: delays and register counts to change, the last edit of a vertex or edge wins.
+ * stats: if not null, set to the work done.
+ * Returns an OptResult as opt2 does, r = false without touching graph or WD if an edit is out of range, negative, or
+ * leaves a 0 weight cycle.
+ */
+OptResult eco_reopt(Graph &graph, WDEntry *WD, OptResult &previous, std::vector<EcoEdit> &edits, EcoStats *stats = nullptr) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    EcoStats eco_stats = {0, 0, 0};
+
+    std::vector<int> delays(vertex_count), from(edge_count), to(edge_count), weight(edge_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        delays[v] = graph.vertices[v].weight;
+    }
+    for (int e = 0; e < edge_count; ++e) {
+        from[e] = graph.edges[e].from;
+        to[e] = graph.edges[e].to;
+        weight[e] = graph.edges[e].weight;
+    }
+    CircuitView view = { delays.data(), vertex_count, from.data(), to.data(), weight.data(), edge_count };
+    ViewIndex index(view);
+
+    //final values of the edits, checked on the edited circuit before changing anything
+    std::vector<int> new_delays(delays), new_weight(weight);
+    for (EcoEdit &edit: edits) {
+        if(edit.value < 0) return {false, -1, graph};
+        if(edit.type == ECO_DELAY) {
+            if(edit.id < 0 || edit.id >= vertex_count) return {false, -1, graph};
+            new_delays[edit.id] = edit.value;
+        } else {
+            if(edit.id < 0 || edit.id >= edge_count) return {false, -1, graph};
+            new_weight[edit.id] = edit.value;
+        }
+    }
+    std::vector<int> deltas(vertex_count);
+    CircuitView edited = { new_delays.data(), vertex_count, from.data(), to.data(), new_weight.data(), edge_count };
+    if(view_cp(edited, index, nullptr, deltas.data()) < 0) return {false, -1, graph};
+
+    //Repair WD one edit at a time: added registers first and removed ones last, so no intermediate circuit has a
+    //0 weight cycle (each has at least the registers of the edited one)
+    EcoRepair repair(view, index, eco_stats);
+    for (int e = 0; e < edge_count; ++e) {
+        if(new_weight[e] > weight[e]) {
+            int old_weight = weight[e];
+            weight[e] = new_weight[e];
+            eco_repair_registers(repair, WD, e, old_weight);
+        }
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        if(new_delays[v] != delays[v]) {
+            int old_delay = delays[v];
+            delays[v] = new_delays[v];
+            eco_repair_delay(repair, WD, v, old_delay);
+        }
+    }
+    for (int e = 0; e < edge_count; ++e) {
+        if(new_weight[e] < weight[e]) {
+            int old_weight = weight[e];
+            weight[e] = new_weight[e];
+            eco_repair_registers(repair, WD, e, old_weight);
+        }
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        graph.vertices[v].weight = delays[v];
+    }
+    for (int e = 0; e < edge_count; ++e) {
+        graph.edges[e].weight = weight[e];
+    }
+
+    //previous retiming, legal again for the edited registers
+    std::vector<int> start(vertex_count, 0);
+    if(previous.r) {
+        for (int v = 0; v < vertex_count; ++v) {
+            start[v] = previous.graph.vertices[v].weight;
+        }
+        eco_legalize(view, index, start.data());
+    }
+
+    //Galloping search of the candidates from the previous clock period, warm started FEAS
+    std::vector<int> c_candidates = view_c_candidates(view, WD, view_period_lower_bound(view));
+    int candidate_count = c_candidates.size();
+    std::vector<int> r(start), tmp_r(vertex_count);
+    int c = -1;
+    int bot = 0;
+    int top = candidate_count-1;
+    int b = previous.r ? std::lower_bound(c_candidates.begin(), c_candidates.end(), previous.c) - c_candidates.begin() : top/2;
+    bool seen_feasible = false, seen_infeasible = false;
+    int step = 1;
+    while(bot <= top) {
+        b = std::min(std::max(b, bot), top);
+        //from the best retiming so far, the closest to the ones of lower clock periods
+        std::copy(r.begin(), r.end(), tmp_r.begin());
+        ViewResult feas_result = view_feas_from(view, index, c_candidates[b], tmp_r.data(), deltas.data());
+        ++eco_stats.probes;
+
+#ifdef ECODEBUG
+        printf("[ECO] c: %d\tfound: %d\n", c_candidates[b], feas_result.r);
+#endif
+
+        if(feas_result.r) {
+            //FEAS may go below the probed candidate, the next ones to try are below c
+            c = feas_result.c;
+            top = std::lower_bound(c_candidates.begin(), c_candidates.end(), c) - c_candidates.begin() - 1;
+            std::copy(tmp_r.begin(), tmp_r.end(), r.begin());
+            seen_feasible = true;
+        } else {
+            bot = b + 1;
+            seen_infeasible = true;
+        }
+
+        if(seen_feasible && seen_infeasible) {
+            b = (top + bot)/2;
+        } else if(seen_feasible) {
+            b = top - step + 1;
+        } else {
+            b = bot + step - 1;
+        }
+        step *= 2;
+    }
+
+    if(stats) *stats = eco_stats;
+    if(c < 0) return {false, c, graph};
+
+    Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        retimed_vertices[v] = Vertex(r[v]);
+    }
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int e = 0; e < edge_count; ++e) {
+        retimed_edges[e] = Edge(from[e], to[e], view_retimed_weight(view, r.data(), e));
+    }
+    return {true, c, Graph(retimed_vertices, retimed_edges, vertex_count, edge_count)};
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "types.h"
 #include "cp.cpp"
+#include "trace.cpp"
+#include "instrument.cpp"
 
 //#define FEASDEBUG
 
@@ -23,10 +25,9 @@ struct FeasResult {
  * deltas: int array of vertex_count size to calculate CP algorithm
  * Returns a FeasResult
  */
+template<typename Instrument = NoInstrument>
 FeasResult feas(Graph &graph, int target_c, int *deltas) {
-#ifdef SPACEBENCH
-    space_bench->push_stack();
-#endif
+    Instrument::enter("feas");
     int vertex_count = graph.vertex_count;
     int edge_count = graph.edge_count;
 
@@ -47,10 +48,8 @@ FeasResult feas(Graph &graph, int target_c, int *deltas) {
         retimed_edges[j] = { edge.from, edge.to, edge.weight };
     }
 
-#ifdef SPACEBENCH
-    space_bench->allocated(sizeof(Vertex) * vertex_count, true, VERTEX, "retimed vertices");
-    space_bench->allocated(sizeof(Edge) * edge_count, true, EDGE, "retimed edges");
-#endif
+    Instrument::allocated(sizeof(Vertex) * vertex_count, true, VERTEX, "retimed vertices");
+    Instrument::allocated(sizeof(Edge) * edge_count, true, EDGE, "retimed edges");
 
     bool changed = true;
 
@@ -58,9 +57,10 @@ FeasResult feas(Graph &graph, int target_c, int *deltas) {
     int i;
     for (i = 1; i < vertex_count && changed; ++i) {
         changed = false;
+        Instrument::count(TRACE_FEAS_ITERATIONS, 1);
 
         //Run CP to calculate deltas
-        cp(gr, deltas);
+        cp<Instrument>(gr, deltas);
 
         //Increment r(v) with values > target_c
         for (int v = 0; v < vertex_count; ++v) {
@@ -78,14 +78,12 @@ FeasResult feas(Graph &graph, int target_c, int *deltas) {
     }
 
     //Run CP one last time
-    int c = cp(gr, deltas);
+    int c = cp<Instrument>(gr, deltas);
  
     //Build retimed graph
     Graph retimed(retimed_vertices, retimed_edges, vertex_count, edge_count);
 
-#ifdef SPACEBENCH
-    space_bench->pop_stack();
-#endif
+    Instrument::leave();
 
     return { c <= target_c, c, retimed };
 }
@@ -0,0 +1,346 @@
+#ifndef GRAPHIO
+#define GRAPHIO
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include "types.h"
+
+//#define GRAPHIODEBUG
+
+#ifdef GRAPHIODEBUG
+#include <iostream>
+#endif
+
+/**
+ * BINARY GRAPH FORMAT
+ * Little endian file made of a fixed size header followed by its sections, each one aligned to GRAPH_FILE_ALIGNMENT:
+ * - vertices: vertex_count Vertex (int weight).
+ * - edges: edge_count Edge (int from, int to, int weight).
+ * - csr (optional): out edges of each vertex, vertex_count+1 int offsets into edge_count int edge indices.
+ * - wd (optional): vertex_count * vertex_count WDEntry, the WD matrix as returned by wd.
+ * Sections are stored exactly as the arrays used by the algorithms, so they can be read or mapped as they are.
+ * An offset of 0 means that the section is not present.
+ * Readers reject files whose edges do not join two of its vertices or have a negative register count (check_graph_edges),
+ * so a corrupt file fails to load instead of sending the algorithms out of their arrays.
+ */
+const char GRAPH_FILE_MAGIC[8] = {'R', 'E', 'T', 'G', 'R', 'A', 'P', 'H'};
+const uint32_t GRAPH_FILE_VERSION = 1;
+const uint64_t GRAPH_FILE_ALIGNMENT = 64;
+
+struct GraphFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags; //reserved
+    int64_t vertex_count;
+    int64_t edge_count;
+    uint64_t vertices_offset;
+    uint64_t edges_offset;
+    uint64_t csr_offset;
+    uint64_t wd_offset;
+    uint64_t reserved[8];
+};
+
+uint64_t align_graph_file_offset(uint64_t offset) {
+    return (offset + GRAPH_FILE_ALIGNMENT - 1) / GRAPH_FILE_ALIGNMENT * GRAPH_FILE_ALIGNMENT;
+}
+
+/**
+ * Writes a graph file section by section, without needing the whole graph in memory.
+ * The amount of vertices must be known up front, edges are appended in blocks and counted.
+ * The header is written last, by close, so an unfinished file is never taken as valid.
+ */
+struct GraphFileWriter {
+    FILE *file;
+    GraphFileHeader header;
+    bool ok;
+    bool edges_done; //no more edges can be appended once an optional section is written
+    uint64_t end;
+
+    GraphFileWriter(): file(nullptr), ok(false), edges_done(false), end(0) {}
+
+    bool open(std::string path, int vertex_count) {
+        file = fopen(path.c_str(), "wb");
+        if(!file) return false;
+
+        memset(&header, 0, sizeof(GraphFileHeader));
+        header.vertex_count = vertex_count;
+        header.vertices_offset = align_graph_file_offset(sizeof(GraphFileHeader));
+        header.edges_offset = align_graph_file_offset(header.vertices_offset + sizeof(Vertex) * vertex_count);
+        end = header.edges_offset;
+
+        //zeroed header until close
+        ok = fwrite(&header, sizeof(GraphFileHeader), 1, file) == 1;
+        return ok;
+    }
+
+    //vertices [first, first+count)
+    bool write_vertices(int first, Vertex *vertices, int count) {
+        if(!ok || count == 0) return ok;
+        ok = fseeko(file, header.vertices_offset + sizeof(Vertex) * first, SEEK_SET) == 0
+            && fwrite(vertices, sizeof(Vertex), count, file) == (size_t) count;
+        return ok;
+    }
+
+    bool append_edges(Edge *edges, int count) {
+        if(!ok || count == 0) return ok;
+        ok = !edges_done
+            && fseeko(file, header.edges_offset + sizeof(Edge) * header.edge_count, SEEK_SET) == 0
+            && fwrite(edges, sizeof(Edge), count, file) == (size_t) count;
+        header.edge_count += count;
+        end = header.edges_offset + sizeof(Edge) * header.edge_count;
+        return ok;
+    }
+
+    //Writes an optional section after the last one, returns its offset (0 if it could not be written)
+    uint64_t write_section(void *data, uint64_t size) {
+        edges_done = true;
+        if(!ok) return 0;
+        uint64_t offset = align_graph_file_offset(end);
+        ok = fseeko(file, offset, SEEK_SET) == 0 && (size == 0 || fwrite(data, size, 1, file) == 1);
+        end = offset + size;
+        return ok ? offset : 0;
+    }
+
+    //offsets: vertex_count+1 offsets into edge_ids, edge_ids: edge_count edge indices (see build_csr)
+    bool write_csr(int *offsets, int *edge_ids) {
+        uint64_t offset = write_section(offsets, sizeof(int) * (header.vertex_count+1));
+        write_section(edge_ids, sizeof(int) * header.edge_count);
+        header.csr_offset = offset;
+        return ok;
+    }
+
+    bool write_wd(WDEntry *WD) {
+        header.wd_offset = write_section(WD, sizeof(WDEntry) * header.vertex_count * header.vertex_count);
+        return ok;
+    }
+
+    //Writes the header and closes the file, returns true if everything was written
+    bool close() {
+        if(!file) return false;
+        if(ok) {
+            memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC));
+            header.version = GRAPH_FILE_VERSION;
+            ok = fseeko(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(GraphFileHeader), 1, file) == 1;
+        }
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+};
+
+/**
+ * Builds the out edges of each vertex: the edges leaving v are edge_ids[offsets[v]] to edge_ids[offsets[v+1]-1].
+ * offsets: array of size graph.vertex_count+1.
+ * edge_ids: array of size graph.edge_count.
+ * O(V + E).
+ */
+void build_csr(Graph &graph, int *offsets, int *edge_ids) {
+    for (int v = 0; v <= graph.vertex_count; ++v) {
+        offsets[v] = 0;
+    }
+    for (int i = 0; i < graph.edge_count; ++i) {
+        ++offsets[graph.edges[i].from+1];
+    }
+    for (int v = 0; v < graph.vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    int *position = (int *) malloc(sizeof(int) * graph.vertex_count);
+    for (int v = 0; v < graph.vertex_count; ++v) {
+        position[v] = offsets[v];
+    }
+    for (int i = 0; i < graph.edge_count; ++i) {
+        edge_ids[position[graph.edges[i].from]++] = i;
+    }
+    free(position);
+}
+
+/**
+ * Writes the graph into a binary graph file.
+ * csr: also write the CSR section, for readers of the file other than the loaders below (they do not use it).
+ * WD: if not null, WD matrix of the graph to cache in the file.
+ * Returns true if the file was written.
+ */
+bool write_graph(Graph &graph, std::string path, bool csr = false, WDEntry *WD = nullptr) {
+    GraphFileWriter writer;
+    writer.open(path, graph.vertex_count);
+    writer.write_vertices(0, graph.vertices, graph.vertex_count);
+    writer.append_edges(graph.edges, graph.edge_count);
+    if(csr) {
+        int *offsets = (int *) malloc(sizeof(int) * (graph.vertex_count+1));
+        int *edge_ids = (int *) malloc(sizeof(int) * graph.edge_count);
+        build_csr(graph, offsets, edge_ids);
+        writer.write_csr(offsets, edge_ids);
+        free(offsets);
+        free(edge_ids);
+    }
+    if(WD) writer.write_wd(WD);
+    return writer.close();
+}
+
+//True if count elements of element_size bytes fit in a file of file_size bytes from offset, an aligned offset past the
+//header. Written so that nothing overflows whatever the header holds. Empty sections are not written, so they are not
+//checked.
+bool graph_file_section_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t file_size) {
+    if(offset < sizeof(GraphFileHeader) || offset % GRAPH_FILE_ALIGNMENT != 0 || offset > file_size) return false;
+    return count <= (file_size - offset) / element_size;
+}
+
+//Checks magic, version and that the sections fit in a file of file_size bytes
+bool check_graph_file_header(GraphFileHeader &header, uint64_t file_size) {
+    if(memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC)) != 0) return false;
+    if(header.version != GRAPH_FILE_VERSION) return false;
+    if(header.vertex_count < 0 || header.vertex_count > MAXINT || header.edge_count < 0 || header.edge_count > MAXINT) return false;
+    uint64_t vertex_count = header.vertex_count;
+    uint64_t edge_count = header.edge_count;
+    if(vertex_count > 0 && !graph_file_section_fits(header.vertices_offset, vertex_count, sizeof(Vertex), file_size)) return false;
+    if(edge_count > 0 && !graph_file_section_fits(header.edges_offset, edge_count, sizeof(Edge), file_size)) return false;
+    if(header.csr_offset) {
+        if(!graph_file_section_fits(header.csr_offset, vertex_count+1, sizeof(int), file_size)) return false;
+        uint64_t edge_ids_offset = align_graph_file_offset(header.csr_offset + sizeof(int) * (vertex_count+1));
+        if(edge_count > 0 && !graph_file_section_fits(edge_ids_offset, edge_count, sizeof(int), file_size)) return false;
+    }
+    if(header.wd_offset && vertex_count > 0 && !graph_file_section_fits(header.wd_offset, vertex_count * vertex_count, sizeof(WDEntry), file_size)) return false;
+    return true;
+}
+
+//Checks that every edge joins two vertices of the graph and has a non negative register count. O(E).
+bool check_graph_edges(Graph &graph) {
+    for (int i = 0; i < graph.edge_count; ++i) {
+        Edge &edge = graph.edges[i];
+        if(edge.from < 0 || edge.from >= graph.vertex_count || edge.to < 0 || edge.to >= graph.vertex_count || edge.weight < 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Reads a binary graph file into newly allocated vertex and edge arrays.
+ * graph: where the read graph is stored, its arrays must be freed by the caller.
+ * Returns false if the file can not be read or is not a valid graph file.
+ */
+bool read_graph(std::string path, Graph *graph) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if(!file) return false;
+
+    GraphFileHeader header;
+    bool ok = fread(&header, sizeof(GraphFileHeader), 1, file) == 1
+        && fseeko(file, 0, SEEK_END) == 0
+        && check_graph_file_header(header, ftello(file));
+
+    Vertex *vertices = nullptr;
+    Edge *edges = nullptr;
+    if(ok) {
+        vertices = (Vertex *) malloc(sizeof(Vertex) * header.vertex_count);
+        edges = (Edge *) malloc(sizeof(Edge) * header.edge_count);
+        ok = fseeko(file, header.vertices_offset, SEEK_SET) == 0
+            && fread(vertices, sizeof(Vertex), header.vertex_count, file) == (size_t) header.vertex_count
+            && fseeko(file, header.edges_offset, SEEK_SET) == 0
+            && fread(edges, sizeof(Edge), header.edge_count, file) == (size_t) header.edge_count;
+    }
+    fclose(file);
+    if(ok) {
+        Graph read(vertices, edges, header.vertex_count, header.edge_count);
+        ok = check_graph_edges(read);
+    }
+
+    if(!ok) {
+        free(vertices);
+        free(edges);
+        return false;
+    }
+
+#ifdef GRAPHIODEBUG
+    printf("Read %s: %d vertices, %d edges\n", path.c_str(), (int) header.vertex_count, (int) header.edge_count);
+#endif
+
+    *graph = Graph(vertices, edges, header.vertex_count, header.edge_count);
+    return true;
+}
+
+/**
+ * Reads a binary graph file held in memory (received over a socket, for instance) without copying it.
+ * data: the whole file, aligned at least as an int.
+ * graph: where the graph is stored, its arrays point into data.
+ * Returns false if data is not a valid graph file.
+ */
+bool graph_from_buffer(const char *data, size_t size, Graph *graph) {
+    if(size < sizeof(GraphFileHeader)) return false;
+    GraphFileHeader *header = (GraphFileHeader *) data;
+    if(!check_graph_file_header(*header, size)) return false;
+    *graph = Graph((Vertex *) (data + header->vertices_offset), (Edge *) (data + header->edges_offset), header->vertex_count, header->edge_count);
+    return check_graph_edges(*graph);
+}
+
+struct MappedGraph {
+    bool r; //the file was mapped
+    Graph graph; //vertices and edges point into the mapping
+    WDEntry *WD; //cached WD matrix, null if the file has no WD section
+    void *map;
+    size_t map_size;
+};
+
+/**
+ * Maps a binary graph file into memory without copying it. The edges are read once to validate them
+ * (check_graph_edges), O(E); the vertices and the WD section are only loaded as the algorithms touch them.
+ * The mapping is private, writing to the graph arrays never changes the file.
+ * Returns a MappedGraph, r = false if the file could not be mapped or is not a valid graph file.
+ * The graph arrays must not be freed, release everything with unmap_graph.
+ */
+MappedGraph map_graph(std::string path) {
+    MappedGraph mapped = {false, Graph(nullptr, nullptr, 0, 0), nullptr, nullptr, 0};
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return mapped;
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || (uint64_t) file_stat.st_size < sizeof(GraphFileHeader)) {
+        close(fd);
+        return mapped;
+    }
+
+    void *map = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return mapped;
+
+    char *base = (char *) map;
+    GraphFileHeader *header = (GraphFileHeader *) base;
+    if(!check_graph_file_header(*header, file_stat.st_size)) {
+        munmap(map, file_stat.st_size);
+        return mapped;
+    }
+
+    Graph graph((Vertex *) (base + header->vertices_offset), (Edge *) (base + header->edges_offset), header->vertex_count, header->edge_count);
+    if(!check_graph_edges(graph)) {
+        munmap(map, file_stat.st_size);
+        return mapped;
+    }
+
+    mapped.r = true;
+    mapped.map = map;
+    mapped.map_size = file_stat.st_size;
+    mapped.graph = graph;
+    if(header->wd_offset) {
+        mapped.WD = (WDEntry *) (base + header->wd_offset);
+    }
+
+#ifdef GRAPHIODEBUG
+    printf("Mapped %s: %d vertices, %d edges, wd: %d\n", path.c_str(), mapped.graph.vertex_count, mapped.graph.edge_count,
+            mapped.WD != nullptr);
+#endif
+
+    return mapped;
+}
+
+void unmap_graph(MappedGraph &mapped) {
+    if(mapped.map) munmap(mapped.map, mapped.map_size);
+    mapped.r = false;
+    mapped.map = nullptr;
+}
+
+#endif
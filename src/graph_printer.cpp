@@ -1,45 +1,305 @@
 #ifndef GRAPHPRINTER
 #define GRAPHPRINTER
 
-#include <fstream>
+#include <stdio.h>
+#include <string.h>
 #include <string>
+#include <vector>
 #include "types.h"
+#include "cp.cpp"
+
+//#define GRAPHPRINTERZLIB //allows compressed output, link with -lz
+
+#ifdef GRAPHPRINTERZLIB
+#include <zlib.h>
+#endif
+
+const size_t GRAPH_WRITER_BUFFER_SIZE = 1<<20;
+
+/**
+ * Buffered text writer, flushing GRAPH_WRITER_BUFFER_SIZE bytes at a time, with its own integer formatting.
+ * Output goes to a file, optionally gzip compressed on the fly (needs GRAPHPRINTERZLIB), or to stdout.
+ */
+struct GraphWriter {
+    FILE *file;
+#ifdef GRAPHPRINTERZLIB
+    gzFile gz_file;
+#endif
+    char *buffer;
+    size_t used;
+    bool ok;
+
+    GraphWriter(): file(nullptr), used(0), ok(false) {
+#ifdef GRAPHPRINTERZLIB
+        gz_file = nullptr;
+#endif
+        buffer = (char *) malloc(GRAPH_WRITER_BUFFER_SIZE);
+    }
+
+    ~GraphWriter() {
+        close();
+        free(buffer);
+    }
+
+    bool open(std::string path, bool compress = false) {
+        if(compress) {
+#ifdef GRAPHPRINTERZLIB
+            gz_file = gzopen(path.c_str(), "wb6");
+            ok = gz_file != nullptr;
+#else
+            ok = false;
+#endif
+        } else {
+            file = fopen(path.c_str(), "wb");
+            ok = file != nullptr;
+        }
+        return ok;
+    }
+
+    void open_stdout() {
+        file = stdout;
+        ok = true;
+    }
+
+    void flush() {
+        if(used == 0) return;
+#ifdef GRAPHPRINTERZLIB
+        if(gz_file) {
+            ok = gzwrite(gz_file, buffer, used) == (int) used && ok;
+            used = 0;
+            return;
+        }
+#endif
+        if(file) ok = fwrite(buffer, 1, used, file) == used && ok;
+        used = 0;
+    }
+
+    //Flushes and closes the file (stdout is only flushed), returns true if everything was written
+    bool close() {
+        flush();
+#ifdef GRAPHPRINTERZLIB
+        if(gz_file) {
+            ok = gzclose(gz_file) == Z_OK && ok;
+            gz_file = nullptr;
+        }
+#endif
+        if(file == stdout) {
+            fflush(stdout);
+        } else if(file) {
+            ok = fclose(file) == 0 && ok;
+        }
+        file = nullptr;
+        return ok;
+    }
+
+    void write(const char *data, size_t size) {
+        if(used + size > GRAPH_WRITER_BUFFER_SIZE) {
+            flush();
+            if(size > GRAPH_WRITER_BUFFER_SIZE) {
+                if(file) ok = fwrite(data, 1, size, file) == size && ok;
+#ifdef GRAPHPRINTERZLIB
+                if(gz_file) ok = gzwrite(gz_file, data, size) == (int) size && ok;
+#endif
+                return;
+            }
+        }
+        memcpy(buffer + used, data, size);
+        used += size;
+    }
+
+    void write(const char *text) {
+        write(text, strlen(text));
+    }
+
+    void write(const std::string &text) {
+        write(text.data(), text.size());
+    }
+
+    //Formats two digits at a time
+    void write_int(long long value) {
+        static const char digit_pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        char text[24];
+        char *end = text + sizeof(text);
+        char *p = end;
+        unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long) value : value;
+        while(magnitude >= 100) {
+            int pair = (magnitude % 100) * 2;
+            magnitude /= 100;
+            *--p = digit_pairs[pair+1];
+            *--p = digit_pairs[pair];
+        }
+        if(magnitude >= 10) {
+            *--p = digit_pairs[magnitude*2+1];
+            *--p = digit_pairs[magnitude*2];
+        } else {
+            *--p = '0' + magnitude;
+        }
+        if(value < 0) *--p = '-';
+        write(p, end - p);
+    }
+};
 
 void print_graph(Graph &graph, std::string name) {
-    printf("------ Graph %s ------ \n", name.c_str());
-    printf("--- VERTEX --- \n");
+    GraphWriter writer;
+    writer.open_stdout();
+    fflush(stdout);
+
+    writer.write("------ Graph ");
+    writer.write(name);
+    writer.write(" ------ \n--- VERTEX --- \n");
     for (int i = 0; i < graph.vertex_count; ++i) {
-        printf("r(V%d) = %d\n", i, graph.vertices[i].weight);
+        writer.write("r(V");
+        writer.write_int(i);
+        writer.write(") = ");
+        writer.write_int(graph.vertices[i].weight);
+        writer.write("\n");
     }
-    printf("--- EDGES --- \n");
+    writer.write("--- EDGES --- \n");
     for (int i = 0; i < graph.edge_count; ++i) {
-        printf("(%d, %d, [%d]) \n", graph.edges[i].from, graph.edges[i].to, graph.edges[i].weight);
+        writer.write("(");
+        writer.write_int(graph.edges[i].from);
+        writer.write(", ");
+        writer.write_int(graph.edges[i].to);
+        writer.write(", [");
+        writer.write_int(graph.edges[i].weight);
+        writer.write("]) \n");
     }
+    writer.close();
 }
 
-void to_dot(Graph &graph, std::string path) {
+void write_dot_vertex(GraphWriter &writer, int vertex, int weight, const char *color) {
+    writer.write_int(vertex);
+    writer.write("[label=\"(");
+    writer.write_int(vertex);
+    writer.write(", ");
+    writer.write_int(weight);
+    writer.write(")\" , color = \"");
+    writer.write(color);
+    writer.write("\"]\n");
+}
 
-    std::ofstream dot_file(path);
-    dot_file << "digraph D {\n"
-        << "  rankdir=LR\n"
-        << "  size=\"5,3\"\n"
-        << "  ratio=\"fill\"\n"
-        << "  edge[style=\"bold\"]\n" << "  node[shape=\"circle\"]\n";
+void write_dot_edge(GraphWriter &writer, Edge edge, const char *color) {
+    writer.write_int(edge.from);
+    writer.write(" -> ");
+    writer.write_int(edge.to);
+    writer.write("[label=\"");
+    writer.write_int(edge.weight);
+    writer.write("\" , color = \"");
+    writer.write(color);
+    writer.write("\"]\n");
+}
+
+const char *DOT_HEADER = "digraph D {\n"
+        "  rankdir=LR\n"
+        "  size=\"5,3\"\n"
+        "  ratio=\"fill\"\n"
+        "  edge[style=\"bold\"]\n"
+        "  node[shape=\"circle\"]\n";
 
-    Edge *edges = graph.edges;
-    Vertex *vertices = graph.vertices;
+/**
+ * Writes the graph as a dot file.
+ * compress: gzip the file on the fly (needs GRAPHPRINTERZLIB).
+ * Returns true if the file was written.
+ */
+bool to_dot(Graph &graph, std::string path, bool compress = false) {
+    GraphWriter writer;
+    if(!writer.open(path, compress)) return false;
 
+    writer.write(DOT_HEADER);
     for(int i = 0; i < graph.vertex_count; ++i) {
-        Vertex vertex = vertices[i];
-        dot_file << i << "[label=\"(" << i << ", " << vertex.weight << ")\" , color = \"black\"]\n";
+        write_dot_vertex(writer, i, graph.vertices[i].weight, "black");
     }
     for(int i = 0; i < graph.edge_count; ++i) {
-        Edge edge = edges[i];
-        dot_file << edge.from << " -> " << edge.to << "[label=\"" << edge.weight << "\" , color = \"black\"]\n";
+        write_dot_edge(writer, graph.edges[i], "black");
+    }
+    writer.write("}");
+
+    return writer.close();
+}
+
+/**
+ * Writes only the given edges of the graph, and their vertices, as a dot file. Vertices keep their ids, 0 weight edges are red.
+ * edge_ids: indices of the edges to write, for example the ones returned by critical_edges.
+ * compress: gzip the file on the fly (needs GRAPHPRINTERZLIB).
+ * Returns true if the file was written.
+ */
+bool to_dot_subgraph(Graph &graph, std::string path, std::vector<int> &edge_ids, bool compress = false) {
+    GraphWriter writer;
+    if(!writer.open(path, compress)) return false;
+
+    std::vector<bool> written(graph.vertex_count, false);
+    writer.write(DOT_HEADER);
+    for (int e: edge_ids) {
+        Edge edge = graph.edges[e];
+        for (int v: {edge.from, edge.to}) {
+            if(written[v]) continue;
+            written[v] = true;
+            write_dot_vertex(writer, v, graph.vertices[v].weight, "black");
+        }
+    }
+    for (int e: edge_ids) {
+        write_dot_edge(writer, graph.edges[e], graph.edges[e].weight == 0 ? "red" : "black");
+    }
+    writer.write("}");
+
+    return writer.close();
+}
+
+/**
+ * Edges of the critical paths of the graph: 0 weight paths whose delay is the clock period given by CP.
+ * Vertex weights are taken as delays, as in cp (for a retimed graph, use it with the original vertices).
+ * Returns the indices of the critical edges. O(V + E).
+ */
+std::vector<int> critical_edges(Graph &graph) {
+    int vertex_count = graph.vertex_count;
+    int *deltas = (int *) malloc(sizeof(int) * vertex_count);
+    int c = cp(graph, deltas);
+
+    //0 weight edges reaching each vertex
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (int i = 0; i < graph.edge_count; ++i) {
+        if(graph.edges[i].weight == 0) ++offsets[graph.edges[i].to+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> in_edges(offsets[vertex_count]);
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int i = 0; i < graph.edge_count; ++i) {
+            if(graph.edges[i].weight == 0) in_edges[position[graph.edges[i].to]++] = i;
+        }
+    }
+
+    //walk back from the vertices that reach the clock period through the predecessors that define their delta
+    std::vector<int> result;
+    std::vector<bool> critical(vertex_count, false);
+    std::vector<int> stack;
+    for (int v = 0; v < vertex_count; ++v) {
+        if(deltas[v] == c) {
+            critical[v] = true;
+            stack.push_back(v);
+        }
+    }
+    while(!stack.empty()) {
+        int v = stack.back();
+        stack.pop_back();
+        for (int i = offsets[v]; i < offsets[v+1]; ++i) {
+            int u = graph.edges[in_edges[i]].from;
+            if(deltas[u] != deltas[v] - graph.vertices[v].weight) continue;
+            result.push_back(in_edges[i]);
+            if(!critical[u]) {
+                critical[u] = true;
+                stack.push_back(u);
+            }
+        }
     }
-    dot_file << "}";
 
-    dot_file.close();
+    free(deltas);
+    return result;
 }
 
 #endif
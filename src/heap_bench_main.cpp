@@ -0,0 +1,130 @@
+#include "heap_profiler.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "types.h"
+#include "cp.cpp"
+#include "wd.cpp"
+#include "opt.cpp"
+#include "feas.cpp"
+#include "min_area.cpp"
+#include "bench_fixtures.cpp"
+
+/**
+ * Heap benchmark of the algorithms, measured by the interposing profiler of heap_profiler.cpp instead of the
+ * SpaceBench bookkeeping, on the seeded random fixtures of bench_fixtures.cpp.
+ * Every run opens a scope for the algorithm, with nested scopes for its steps, and prints the peak heap, bytes and
+ * allocations of each. The peak heap of the algorithm is then fitted against the vertex count.
+ * Usage: heap_bench_main [max_index], the fixtures 0 to max_index (default 9, 2^12 vertices).
+ */
+
+typedef void (*HeapBenchmark)(Graph &graph, Fixture &fixture);
+
+void print_phases(std::vector<HeapPhase> &phases) {
+    for (HeapPhase &phase: phases) {
+        printf("%*s%-10s peak heap: %12zu B\tallocated: %12zu B\tallocations: %8zu\tpeak RSS: %8ld kB\n", 2 + 2*phase.depth, "",
+                phase.name, phase.peak, phase.allocated, phase.allocations, phase.peak_rss);
+    }
+}
+
+void HB_cp(Graph &graph, Fixture &fixture) {
+    HeapScope scope("cp");
+    int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    cp(graph, deltas);
+    free(deltas);
+}
+
+void HB_wd(Graph &graph, Fixture &fixture) {
+    HeapScope scope("wd");
+    WDEntry *WD = wd(graph);
+    free(WD);
+}
+
+void HB_opt(Graph &graph, bool use_opt1) {
+    HeapScope scope(use_opt1 ? "opt1" : "opt2");
+    WDEntry *WD;
+    {
+        HeapScope wd_scope("wd");
+        WD = wd(graph);
+    }
+    OptResult result;
+    {
+        HeapScope opt_scope(use_opt1 ? "bellman" : "feas");
+        result = use_opt1 ? opt1(graph, WD) : opt2(graph, WD);
+    }
+    free(WD);
+    if(result.r) {
+        free(result.graph.vertices);
+        free(result.graph.edges);
+    }
+}
+
+void HB_opt1(Graph &graph, Fixture &fixture) {
+    HB_opt(graph, true);
+}
+
+void HB_opt2(Graph &graph, Fixture &fixture) {
+    HB_opt(graph, false);
+}
+
+void HB_feas(Graph &graph, Fixture &fixture) {
+    int target_c = fixture_period(fixture);
+    HeapScope scope("feas");
+    int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    FeasResult result = feas(graph, target_c, deltas);
+    free(deltas);
+    if(result.r) {
+        free(result.graph.vertices);
+        free(result.graph.edges);
+    }
+}
+
+void HB_min_area(Graph &graph, Fixture &fixture) {
+    int c = fixture_period(fixture);
+    WDEntry *WD = wd(graph);
+    {
+        HeapScope scope("min_area");
+        OptResult result = min_area(graph, WD, c);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+    }
+    free(WD);
+}
+
+void run_heap_benchmark(const char *name, HeapBenchmark benchmark, int max_index) {
+    printf("%s Benchmark:\n", name);
+    std::vector<double> n;
+    std::vector<double> peaks;
+    for (int i = 0; i <= max_index; ++i) {
+        Fixture &fixture = random_fixture(i);
+        Graph &graph = fixture.graph;
+        take_heap_phases();
+
+        benchmark(graph, fixture);
+
+        std::vector<HeapPhase> phases = take_heap_phases();
+        printf("%s/%d\tvertices: %d, edges: %d\n", name, i, graph.vertex_count, graph.edge_count);
+        print_phases(phases);
+        n.push_back(graph.vertex_count);
+        peaks.push_back(phases.empty() ? 0 : phases.front().peak);
+    }
+
+    MemoryFit fit = fit_memory(n, peaks);
+    printf("%s: %.2f %s bytes (N = vertices, RMS %.0f%%)\n", name, fit.coefficient, fit.complexity, fit.rms * 100);
+    printf("\n ---------- \n");
+}
+
+int main(int argc, char **argv) {
+    int max_index = argc > 1 ? atoi(argv[1]) : 9;
+    max_index = std::max(0, std::min(max_index, graph_max_index));
+
+    run_heap_benchmark("cp", HB_cp, max_index);
+    run_heap_benchmark("wd", HB_wd, max_index);
+    run_heap_benchmark("opt1", HB_opt1, max_index);
+    run_heap_benchmark("feas", HB_feas, max_index);
+    run_heap_benchmark("opt2", HB_opt2, max_index);
+    run_heap_benchmark("min_area", HB_min_area, max_index);
+}
@@ -0,0 +1,291 @@
+#ifndef HEAPPROFILER
+#define HEAPPROFILER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <malloc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Heap profiler that interposes malloc, calloc, realloc, free, the aligned allocators and operator new/delete, so every
+ * byte is measured: the Graph arrays, BGL graphs, STL containers and anything the algorithms allocate internally.
+ * Sizes are the usable sizes given by the allocator (malloc_usable_size), what the heap really hands out.
+ * Including this file replaces the allocator of the whole program, it is meant for heap_bench_main.cpp only.
+ *
+ * Bytes are attributed to the innermost open HeapScope (phases can nest: an "opt1" scope around "wd" and "opt1" ones).
+ * Each scope records its peak heap above the heap it started with, the bytes and allocations made while open,
+ * and the peak RSS of the process (reset by the outermost scope when the kernel allows it).
+ */
+
+const int HEAP_PROFILER_MAX_DEPTH = 16;
+const int HEAP_PROFILER_MAX_PHASES = 256;
+
+struct HeapPhase {
+    const char *name; //must outlive the profiler, string literals
+    int depth;
+    int order; //scopes opened before it
+    size_t base; //heap when the scope opened
+    size_t peak; //peak heap above base while open
+    size_t allocated; //bytes allocated while open
+    size_t allocations;
+    long peak_rss; //kB, VmHWM when the scope closed
+};
+
+struct HeapProfiler {
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    size_t current;
+    size_t peak;
+    HeapPhase open[HEAP_PROFILER_MAX_DEPTH];
+    int depth;
+    HeapPhase closed[HEAP_PROFILER_MAX_PHASES]; //closed scopes, in closing order
+    int closed_count;
+    int opened;
+};
+
+//Zero initialized before any constructor runs, so allocations made during static initialization are counted too
+HeapProfiler heap_profiler;
+
+void heap_profiler_lock() {
+    while(heap_profiler.lock.test_and_set(std::memory_order_acquire));
+}
+
+void heap_profiler_unlock() {
+    heap_profiler.lock.clear(std::memory_order_release);
+}
+
+void heap_profiler_allocated(void *pointer) {
+    if(!pointer) return;
+    size_t size = malloc_usable_size(pointer);
+    heap_profiler_lock();
+    heap_profiler.current += size;
+    if(heap_profiler.current > heap_profiler.peak) heap_profiler.peak = heap_profiler.current;
+    for (int i = 0; i < heap_profiler.depth; ++i) {
+        HeapPhase &phase = heap_profiler.open[i];
+        if(heap_profiler.current > phase.base && heap_profiler.current - phase.base > phase.peak) phase.peak = heap_profiler.current - phase.base;
+    }
+    if(heap_profiler.depth > 0) {
+        HeapPhase &phase = heap_profiler.open[heap_profiler.depth-1];
+        phase.allocated += size;
+        ++phase.allocations;
+    }
+    heap_profiler_unlock();
+}
+
+void heap_profiler_freed(void *pointer) {
+    if(!pointer) return;
+    size_t size = malloc_usable_size(pointer);
+    heap_profiler_lock();
+    heap_profiler.current -= size;
+    heap_profiler_unlock();
+}
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *pointer);
+
+void *malloc(size_t size) {
+    void *pointer = __libc_malloc(size);
+    heap_profiler_allocated(pointer);
+    return pointer;
+}
+
+void *calloc(size_t count, size_t size) {
+    void *pointer = __libc_calloc(count, size);
+    heap_profiler_allocated(pointer);
+    return pointer;
+}
+
+void *realloc(void *pointer, size_t size) {
+    heap_profiler_freed(pointer);
+    void *new_pointer = __libc_realloc(pointer, size);
+    heap_profiler_allocated(new_pointer ? new_pointer : (size ? pointer : nullptr));
+    return new_pointer;
+}
+
+void *memalign(size_t alignment, size_t size) {
+    void *pointer = __libc_memalign(alignment, size);
+    heap_profiler_allocated(pointer);
+    return pointer;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+    void *pointer = memalign(alignment, size);
+    if(!pointer) return ENOMEM;
+    *result = pointer;
+    return 0;
+}
+
+void free(void *pointer) {
+    heap_profiler_freed(pointer);
+    __libc_free(pointer);
+}
+}
+
+void *operator new(size_t size) {
+    void *pointer = malloc(size ? size : 1);
+    if(!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *pointer) noexcept { free(pointer); }
+void operator delete[](void *pointer) noexcept { free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { free(pointer); }
+
+//Value in kB of a /proc/self/status line (VmRSS, VmHWM), read without allocating. -1 if not available.
+long read_proc_status_kb(const char *key) {
+    char buffer[4096];
+    int fd = open("/proc/self/status", O_RDONLY);
+    if(fd < 0) return -1;
+    ssize_t size = read(fd, buffer, sizeof(buffer)-1);
+    close(fd);
+    if(size <= 0) return -1;
+    buffer[size] = '\0';
+    size_t key_size = strlen(key);
+    for (char *line = buffer; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : nullptr) {
+        if(strncmp(line, key, key_size) == 0 && line[key_size] == ':') return atol(line + key_size + 1);
+    }
+    return -1;
+}
+
+//Resets VmHWM to the current RSS (Linux 4.0+), returns false if not allowed
+bool reset_peak_rss() {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if(fd < 0) return false;
+    bool ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+/**
+ * Phase scope: bytes allocated while it is the innermost open scope are attributed to it.
+ * name: phase name, a string literal.
+ */
+struct HeapScope {
+    bool is_open;
+
+    HeapScope(const char *name): is_open(true) {
+        if(heap_profiler.depth == 0) reset_peak_rss();
+        heap_profiler_lock();
+        HeapPhase &phase = heap_profiler.open[heap_profiler.depth];
+        phase = {name, heap_profiler.depth, heap_profiler.opened++, heap_profiler.current, 0, 0, 0, -1};
+        ++heap_profiler.depth;
+        heap_profiler_unlock();
+    }
+
+    ~HeapScope() {
+        close();
+    }
+
+    //Closes the scope and returns its measures
+    HeapPhase close() {
+        if(!is_open) return {};
+        is_open = false;
+        long peak_rss = read_proc_status_kb("VmHWM");
+        heap_profiler_lock();
+        HeapPhase phase = heap_profiler.open[--heap_profiler.depth];
+        phase.peak_rss = peak_rss;
+        if(heap_profiler.depth > 0) {
+            //a parent also made the allocations of its children
+            HeapPhase &parent = heap_profiler.open[heap_profiler.depth-1];
+            parent.allocated += phase.allocated;
+            parent.allocations += phase.allocations;
+        }
+        if(heap_profiler.closed_count < HEAP_PROFILER_MAX_PHASES) heap_profiler.closed[heap_profiler.closed_count++] = phase;
+        heap_profiler_unlock();
+        return phase;
+    }
+};
+
+//Closed phases since the last call, in opening order (parents before their children)
+std::vector<HeapPhase> take_heap_phases() {
+    //copied out first, the vector allocates and must not do it with the lock held
+    HeapPhase closed[HEAP_PROFILER_MAX_PHASES];
+    heap_profiler_lock();
+    int closed_count = heap_profiler.closed_count;
+    memcpy(closed, heap_profiler.closed, sizeof(HeapPhase) * closed_count);
+    heap_profiler.closed_count = 0;
+    heap_profiler_unlock();
+    std::vector<HeapPhase> phases(closed, closed + closed_count);
+    std::sort(phases.begin(), phases.end(), [](const HeapPhase &a, const HeapPhase &b) { return a.order < b.order; });
+    return phases;
+}
+
+size_t current_heap() {
+    return heap_profiler.current;
+}
+
+/**
+ * Memory complexity fit, like the time complexities of google benchmark:
+ * bytes ~ coefficient * f(N) by least squares, for f in 1, N, N log(N) and N^2, keeping the one with the lowest RMS.
+ * rms is relative to the mean of bytes.
+ */
+struct MemoryFit {
+    const char *complexity;
+    double coefficient;
+    double rms;
+};
+
+MemoryFit fit_memory(std::vector<double> &n, std::vector<double> &bytes) {
+    const char *names[] = { "O(1)", "O(N)", "O(NlgN)", "O(N^2)" };
+    MemoryFit best = { "", 0, INFINITY };
+    if(n.empty()) return best;
+
+    double mean = 0;
+    for (double b: bytes) {
+        mean += b;
+    }
+    mean /= bytes.size();
+
+    for (int c = 0; c < 4; ++c) {
+        std::vector<double> f;
+        for (double x: n) {
+            f.push_back(c == 0 ? 1 : c == 1 ? x : c == 2 ? x * log2(x) : x * x);
+        }
+        double fb = 0;
+        double ff = 0;
+        for (size_t i = 0; i < n.size(); ++i) {
+            fb += f[i] * bytes[i];
+            ff += f[i] * f[i];
+        }
+        double coefficient = fb / ff;
+        double error = 0;
+        for (size_t i = 0; i < n.size(); ++i) {
+            error += pow(bytes[i] - coefficient * f[i], 2);
+        }
+        double rms = sqrt(error / n.size()) / mean;
+        if(rms < best.rms) best = { names[c], coefficient, rms };
+    }
+    return best;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef INSTRUMENT
+#define INSTRUMENT
+
+#include <stddef.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "space_bench.cpp"
+#include "trace.cpp"
+
+/**
+ * Instrumentation policies of the algorithms, given as their Instrument template parameter:
+ *  - NoInstrument (the default): empty inline functions, the algorithms compile as if they were not instrumented.
+ *  - SpaceInstrument: tracks the allocations in a SpaceBench of the calling thread (see space_bench_main.cpp).
+ *  - TraceInstrument: records the trace of the calling thread (see trace.cpp): inclusive time and calls of each
+ *    instrumented algorithm, counters, and the binary search probes.
+ * Every policy keeps its state per thread, so instrumented and uninstrumented runs can go on concurrently in the same
+ * binary. An algorithm calls enter with its name when it starts and leave before it returns, and passes its Instrument
+ * on to the algorithms it calls. Binary searches call probe_start before each probe and probe once it is done.
+ * Policies derive from NoInstrument, so they only define the hooks they use.
+ */
+
+struct NoInstrument {
+    static void enter(const char *) {}
+    static void leave() {}
+    static void allocated(size_t, bool, AllocType, const char * = "") {}
+    static void deallocated(size_t, AllocType, const char * = "") {}
+    static void count(TraceCounter, long long) {}
+    static void probe_start() {}
+    static void probe(const char *, int, int, int, int, bool, int) {}
+};
+
+struct SpaceInstrument: NoInstrument {
+    static SpaceBench &bench() {
+        thread_local SpaceBench bench;
+        return bench;
+    }
+
+    //Starts a new space benchmark on the calling thread, returns its SpaceBench
+    static SpaceBench *reset() {
+        bench() = SpaceBench();
+        return &bench();
+    }
+
+    static void enter(const char *) {
+        bench().push_stack();
+    }
+
+    static void leave() {
+        bench().pop_stack();
+    }
+
+    static void allocated(size_t size, bool heap, AllocType type, const char *extra_info = "") {
+        bench().allocated(size, heap, type, extra_info);
+    }
+
+    static void deallocated(size_t size, AllocType type, const char *extra_info = "") {
+        bench().deallocated(size, type, extra_info);
+    }
+};
+
+struct TraceInstrument: NoInstrument {
+    struct OpenPhase {
+        const char *name;
+        std::chrono::steady_clock::time_point begin;
+    };
+
+    struct State {
+        std::vector<OpenPhase> open;
+        TraceProbeStart probe; //start of the current probe
+    };
+
+    static State &state() {
+        thread_local State state;
+        return state;
+    }
+
+    static void enter(const char *name) {
+        state().open.push_back({name, std::chrono::steady_clock::now()});
+    }
+
+    static void leave() {
+        State &s = state();
+        OpenPhase open = s.open.back();
+        s.open.pop_back();
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - open.begin).count();
+        for (TracePhase &phase: retiming_trace.phases) {
+            if(strcmp(phase.name, open.name) == 0) {
+                phase.time += time;
+                ++phase.calls;
+                return;
+            }
+        }
+        retiming_trace.phases.push_back({open.name, time, 1});
+    }
+
+    static void count(TraceCounter counter, long long n) {
+        retiming_trace.counters[counter] += n;
+    }
+
+    static void probe_start() {
+        state().probe = TraceProbeStart();
+    }
+
+    static void probe(const char *algorithm, int b, int bot, int top, int c, bool feasible, int result_c) {
+        state().probe.record(algorithm, b, bot, top, c, feasible, result_c);
+    }
+};
+
+#endif
@@ -1,5 +1,4 @@
-//#define OPT1DEBUG
-//#define OPT2DEBUG
+//#define OPTDEBUG
 //#define CIRCUITGENDEBUG
 //#define CYCLEFINDERDEBUG
 //#define FEASDEBUG
@@ -8,6 +7,11 @@
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <dirent.h>
 
 #include "types.h"
 #include "graph_printer.cpp" 
@@ -17,6 +21,17 @@
 #include "cp.cpp"
 #include "feas.cpp"
 #include "retiming_checker.cpp"
+#include "reduction.cpp"
+#include "reorder.cpp"
+#include "min_area.cpp"
+#include "multilevel.cpp"
+#include "anytime.cpp"
+#include "netlist_importer.cpp"
+#include "circuit_view.cpp"
+#include "batch.cpp"
+#include "service.cpp"
+#include "eco.cpp"
+#include "circuit_families.cpp"
 
 void print_wd(WDEntry *WD, int vertex_count) {
     std::cout << "---- W ----" << std::endl;
@@ -386,6 +401,1123 @@ void test_n_random(int n, int vertex_count) {
     }
 }
 
+//Test opt1_anytime and opt2_anytime without limits, past their deadline and cancelled after the first probe
+void test_anytime(int n, int vertex_count) {
+    printf("--- Anytime OPT1 and OPT2 on %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count);
+        WDEntry* WD = wd(graph);
+        std::vector<int> deltas(vertex_count);
+        int initial_c = cp(graph, &deltas[0]);
+        OptResult result1 = opt1(graph, WD);
+        OptResult result2 = opt2(graph, WD);
+        printf("CIRCUIT %d: CP: %d\tOPT1 C: %d\tOPT2 C: %d\n", i, initial_c, result1.c, result2.c);
+
+        for(int algorithm = 1; algorithm <= 2; ++algorithm) {
+            int opt_c = algorithm == 1 ? result1.c : result2.c;
+            for(int mode = 0; mode < 3; ++mode) {
+                std::atomic<bool> cancel(false);
+                AnytimeOptions options;
+                options.cancel = &cancel;
+                if(mode == 1) options.deadline = std::chrono::steady_clock::now();
+
+                //bounds only get tighter, and probes are reported in order (none if no candidate is below CP)
+                int calls = 0, lower = 0, upper = MAXINT;
+                bool monotone = true;
+                options.progress = [&](const AnytimeProgress &progress) {
+                    ++calls;
+                    monotone = monotone && progress.probes == calls && progress.lower >= lower && progress.upper <= upper
+                            && progress.lower <= progress.upper;
+                    lower = progress.lower;
+                    upper = progress.upper;
+                    if(mode == 2) cancel = true;
+                };
+
+                AnytimeResult anytime = algorithm == 1 ? opt1_anytime(graph, WD, options) : opt2_anytime(graph, WD, options);
+                Graph retimed(graph.vertices, anytime.graph.edges, vertex_count, graph.edge_count);
+                int anytime_c = cp(retimed, &deltas[0]);
+                bool bounds = anytime.lower <= opt_c && opt_c <= anytime.c && anytime_c <= anytime.c;
+                bool expected = mode == 0 ? anytime.complete && anytime.c == opt_c
+                        : mode == 1 ? calls == 0 && anytime.c == initial_c : calls == 1 || (calls == 0 && anytime.complete);
+                printf("OPT%d %s\tC: %d\tLower: %d\tComplete: %d\tProbes: %d\tLegal: %d%s\n", algorithm,
+                        mode == 0 ? "no limit" : mode == 1 ? "deadline" : "cancel  ", anytime.c, anytime.lower, anytime.complete,
+                        calls, check_legal(graph, anytime.graph, anytime.c, WD),
+                        bounds && expected && monotone ? "" : " (WRONG)");
+
+                free(anytime.graph.vertices);
+                free(anytime.graph.edges);
+            }
+        }
+
+        for(OptResult *r: {&result1, &result2}) {
+            if(r->r) {
+                free(r->graph.vertices);
+                free(r->graph.edges);
+            }
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test opt2 on reduced random circuits against opt2 on the original ones
+void test_reduction(int n, int vertex_count) {
+    printf("--- Testing reduction on %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count);
+
+        //turn a third of the vertices into zero delay buffers
+        for(int v = 0; v < vertex_count; v += 3) {
+            graph.vertices[v].weight = 0;
+        }
+
+        ReducedGraph reduced = reduce_graph(graph);
+        printf("CIRCUIT %d: vertices: %d -> %d, edges: %d -> %d\n", i, graph.vertex_count, reduced.graph.vertex_count, graph.edge_count, reduced.graph.edge_count);
+
+        WDEntry* WD = wd(graph);
+        WDEntry* reduced_WD = wd(reduced.graph);
+
+        OptResult result = opt2(graph, WD);
+        OptResult reduced_result = opt2(reduced.graph, reduced_WD);
+
+        if(result.r && reduced_result.r) {
+            Graph retimed = expand_retiming(reduced, graph, reduced_result.graph);
+            printf("C: %d\treduced C: %d\tLegal: %d\n", result.c, reduced_result.c, check_legal(graph, retimed, reduced_result.c, WD));
+
+            free(retimed.vertices);
+            free(retimed.edges);
+        } else {
+            printf("No retiming found\n");
+        }
+
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        if(reduced_result.r) {
+            free(reduced_result.graph.vertices);
+            free(reduced_result.graph.edges);
+        }
+
+        free_reduced_graph(reduced);
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+        free(reduced_WD);
+    }
+}
+
+//Test the multilevel algorithm on random circuits against opt2
+void test_multilevel(int n, int vertex_count) {
+    printf("--- Testing multilevel on %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count);
+
+        WDEntry* WD = wd(graph);
+        OptResult result = opt2(graph, WD);
+        MultilevelResult ml_result = multilevel(graph, vertex_count / 8);
+
+        printf("CIRCUIT %d: OPT2 C: %d\tMultilevel C: %d\tLower bound: %d\tLevels: %d\tLegal: %d\n", i, result.c,
+                ml_result.c, ml_result.lower_bound, ml_result.levels, check_legal(graph, ml_result.graph, ml_result.c, WD));
+
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(ml_result.graph.vertices);
+        free(ml_result.graph.edges);
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+void test_circuit_file(int vertex_count, unsigned int seed) {
+    printf("--- Testing circuit file with %d vertex ---\n", vertex_count);
+    generate_circuit_file("circuit_1.bin", vertex_count, seed, 1);
+    generate_circuit_file("circuit_n.bin", vertex_count, seed, 4);
+
+    Graph graph, graph_n;
+    if(!read_graph("circuit_1.bin", &graph) || !read_graph("circuit_n.bin", &graph_n)) {
+        printf("Could not read circuit files\n");
+        remove("circuit_1.bin");
+        remove("circuit_n.bin");
+        return;
+    }
+
+    //same seed, same graph, whatever the amount of threads
+    bool same = graph.vertex_count == graph_n.vertex_count && graph.edge_count == graph_n.edge_count;
+    for(int i = 0; same && i < graph.vertex_count; ++i) {
+        same = graph.vertices[i].weight == graph_n.vertices[i].weight;
+    }
+    for(int i = 0; same && i < graph.edge_count; ++i) {
+        same = graph.edges[i].from == graph_n.edges[i].from && graph.edges[i].to == graph_n.edges[i].to && graph.edges[i].weight == graph_n.edges[i].weight;
+    }
+
+    //the mapped graph is the read one, without copies
+    MappedGraph mapped = map_graph("circuit_n.bin");
+    bool mapped_same = mapped.r && mapped.graph.vertex_count == graph.vertex_count && mapped.graph.edge_count == graph.edge_count;
+    for(int i = 0; mapped_same && i < graph.edge_count; ++i) {
+        mapped_same = mapped.graph.edges[i].from == graph.edges[i].from && mapped.graph.edges[i].to == graph.edges[i].to && mapped.graph.edges[i].weight == graph.edges[i].weight;
+    }
+    unmap_graph(mapped);
+
+    //CP fails on 0 weight cycles
+    int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    printf("Vertices: %d\tEdges: %d\tSame: %d\tMapped: %d\tCP: %d\n", graph.vertex_count, graph.edge_count, same, mapped_same, cp(graph, deltas));
+
+    free(deltas);
+    free(graph.vertices);
+    free(graph.edges);
+    free(graph_n.vertices);
+    free(graph_n.edges);
+    remove("circuit_1.bin");
+    remove("circuit_n.bin");
+}
+
+int test_netlist() {
+    //ISCAS89 s27
+    std::ofstream bench_file("s27.bench");
+    bench_file << "INPUT(G0)\nINPUT(G1)\nINPUT(G2)\nINPUT(G3)\nOUTPUT(G17)\n"
+        << "G5 = DFF(G10)\nG6 = DFF(G11)\nG7 = DFF(G13)\n"
+        << "G14 = NOT(G0)\nG17 = NOT(G11)\nG8 = AND(G14, G6)\nG15 = OR(G12, G8)\nG16 = OR(G3, G8)\n"
+        << "G9 = NAND(G16, G15)\nG10 = NOR(G14, G11)\nG11 = NOR(G5, G9)\nG12 = NOR(G1, G7)\nG13 = NOR(G2, G12)\n";
+    bench_file.close();
+
+    NetlistOptions options;
+    options.gate_delays["NOT"] = 1;
+    options.thread_count = 4;
+    options.default_delay = 2;
+    NetlistResult netlist = import_bench("s27.bench", options);
+    if(!netlist.r) {
+        printf("Could not import s27.bench: %s\n", netlist.error.c_str());
+        remove("s27.bench");
+        return 1;
+    }
+
+    Graph graph = netlist.graph;
+    WDEntry* WD = wd(graph);
+    OptResult result = opt2(graph, WD);
+    printf("Vertices: %d\tEdges: %d\tC: %d\tLegal: %d\n", graph.vertex_count, graph.edge_count, result.c,
+            result.r ? check_legal(graph, result.graph, result.c, WD) : 1);
+
+    if(result.r) {
+        free(result.graph.vertices);
+        free(result.graph.edges);
+    }
+    free(graph.vertices);
+    free(graph.edges);
+    free(WD);
+
+    //s27 in BLIF, with a continuation line, latches and the covers of each .names
+    std::ofstream blif_file("s27.blif");
+    blif_file << ".model s27\n.inputs G0 G1 G2 \\\nG3\n.outputs G17\n"
+        << ".latch G10 G5 re clk 0\n.latch G11 G6 re clk 0\n.latch G13 G7 re clk 0\n"
+        << ".names G0 G14\n0 1\n.names G11 G17\n0 1\n.names G14 G6 G8\n11 1\n.names G12 G8 G15\n1- 1\n-1 1\n"
+        << ".names G3 G8 G16\n1- 1\n-1 1\n.names G16 G15 G9\n0- 1\n-0 1\n.names G14 G11 G10\n00 1\n"
+        << ".names G5 G9 G11\n00 1\n.names G1 G7 G12\n00 1\n.names G2 G12 G13\n00 1\n.end\n";
+    blif_file.close();
+
+    //unit delays on both, so the BLIF circuit is the .bench one
+    NetlistOptions unit_options;
+    unit_options.thread_count = 1;
+    NetlistResult bench = import_bench("s27.bench", unit_options);
+    NetlistResult blif = import_blif("s27.blif", unit_options);
+    unit_options.thread_count = 4;
+    NetlistResult blif_threads = import_blif("s27.blif", unit_options);
+    bool same_threads = blif.r && blif_threads.r && blif.vertex_names == blif_threads.vertex_names
+        && blif.graph.vertex_count == blif_threads.graph.vertex_count && blif.graph.edge_count == blif_threads.graph.edge_count;
+    for(int v = 0; same_threads && v < blif.graph.vertex_count; ++v) {
+        same_threads = blif.graph.vertices[v].weight == blif_threads.graph.vertices[v].weight;
+    }
+    for(int e = 0; same_threads && e < blif.graph.edge_count; ++e) {
+        Edge a = blif.graph.edges[e], b = blif_threads.graph.edges[e];
+        same_threads = a.from == b.from && a.to == b.to && a.weight == b.weight;
+    }
+    if(bench.r && blif.r) {
+        WDEntry* bench_WD = wd(bench.graph);
+        WDEntry* blif_WD = wd(blif.graph);
+        OptResult bench_result = opt2(bench.graph, bench_WD);
+        OptResult blif_result = opt2(blif.graph, blif_WD);
+        printf("BLIF vertices: %d (bench %d)\tEdges: %d (bench %d)\tC: %d (bench %d)\tLegal: %d\tSame with 1 and 4 threads: %d\n",
+                blif.graph.vertex_count, bench.graph.vertex_count, blif.graph.edge_count, bench.graph.edge_count, blif_result.c,
+                bench_result.c, blif_result.r ? check_legal(blif.graph, blif_result.graph, blif_result.c, blif_WD) : 1, same_threads);
+        for(OptResult *r: {&bench_result, &blif_result}) {
+            if(r->r) {
+                free(r->graph.vertices);
+                free(r->graph.edges);
+            }
+        }
+        free(bench_WD);
+        free(blif_WD);
+    } else {
+        printf("Could not import s27: %s%s\n", bench.error.c_str(), blif.error.c_str());
+    }
+    for(NetlistResult *n: {&bench, &blif, &blif_threads}) {
+        free(n->graph.vertices);
+        free(n->graph.edges);
+    }
+
+    //constructs that can not be retimed are refused
+    blif_file.open("s27.blif");
+    blif_file << ".model top\n.inputs a\n.outputs b\n.subckt s27 G0=a G17=b\n.end\n";
+    blif_file.close();
+    NetlistResult subckt = import_blif("s27.blif", unit_options);
+    printf("BLIF with .subckt: %s\n", subckt.r ? "imported" : subckt.error.c_str());
+    free(subckt.graph.vertices);
+    free(subckt.graph.edges);
+
+    remove("s27.bench");
+    remove("s27.blif");
+    return 0;
+}
+
+//Test the view algorithms on random circuits kept in separate arrays against the Graph ones
+void test_circuit_view(int n, int vertex_count) {
+    printf("--- Testing views of %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count);
+        std::vector<int> delays(vertex_count), from(graph.edge_count), to(graph.edge_count), weight(graph.edge_count);
+        for(int v = 0; v < vertex_count; ++v) {
+            delays[v] = graph.vertices[v].weight;
+        }
+        for(int e = 0; e < graph.edge_count; ++e) {
+            from[e] = graph.edges[e].from;
+            to[e] = graph.edges[e].to;
+            weight[e] = graph.edges[e].weight;
+        }
+        CircuitView view = { &delays[0], vertex_count, &from[0], &to[0], &weight[0], graph.edge_count };
+
+        WDEntry *WD = wd(graph);
+        WDEntry *view_WD = (WDEntry *) malloc(sizeof(WDEntry) * vertex_count * vertex_count);
+        bool same_wd = view_wd(view, view_WD);
+        for(int j = 0; j < vertex_count * vertex_count && same_wd; ++j) {
+            same_wd = WD[j].W == view_WD[j].W && WD[j].D == view_WD[j].D;
+        }
+
+        OptResult result2 = opt2(graph, WD);
+        std::vector<int> r(vertex_count), deltas(vertex_count);
+        ViewResult view_result1 = view_opt1(view, view_WD, &r[0]);
+        int c1 = view_cp(view, &r[0], &deltas[0]);
+        ViewResult view_result2 = view_opt2(view, view_WD, &r[0]);
+        int c2 = view_cp(view, &r[0], &deltas[0]);
+        ViewResult parallel_result1 = view_opt1(view, view_WD, &r[0], 2);
+        int parallel_c1 = view_cp(view, &r[0], &deltas[0]);
+        bool same_bound = view_period_lower_bound(view) == period_lower_bound(graph);
+
+        printf("Same WD: %d\tOPT2 C: %d\tView OPT1 C: %d (CP %d)\tView OPT2 C: %d (CP %d)\tParallel view OPT1 C: %d (CP %d)\tSame bound: %d\n",
+                same_wd, result2.c, view_result1.c, c1, view_result2.c, c2, parallel_result1.c, parallel_c1, same_bound);
+
+        if(result2.r) {
+            free(result2.graph.vertices);
+            free(result2.graph.edges);
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+        free(view_WD);
+    }
+
+    //view_bellman against bellman on small random constraint systems, the feasible ones being p(y) - p(x) + k, k >= 0
+    std::vector<Edge> known = { Edge(1, 0, -99), Edge(4, 3, 627), Edge(0, 4, -649), Edge(2, 4, 16), Edge(2, 1, 768),
+            Edge(4, 2, -14), Edge(4, 3, 626), Edge(0, 2, -667), Edge(2, 2, 0), Edge(2, 4, 17) };
+    std::mt19937 gen(11);
+    int systems = 2000, same = 0, feasible = 0;
+    for(int i = 0; i < systems; ++i) {
+        std::vector<Edge> arcs = known;
+        if(i > 0) {
+            std::vector<int> p(5);
+            for(int &value: p) value = gen() % 1000;
+            arcs.clear();
+            for(int a = 0; a < 10; ++a) {
+                int x = gen() % 5, y = gen() % 5;
+                int k = i % 2 ? (int) (gen() % 20) : (int) (gen() % 40) - 20;
+                arcs.push_back(Edge(x, y, p[y] - p[x] + k));
+            }
+        }
+        std::vector<int> distance(5), bellman_distance(6);
+        Graph arcs_graph(nullptr, &arcs[0], 5, arcs.size());
+        bool r = view_bellman(5, arcs, &distance[0]);
+        bool bellman_r = bellman(arcs_graph, &bellman_distance[0]);
+        if(r == bellman_r) ++same;
+        if(bellman_r) ++feasible;
+    }
+    printf("View bellman: %d/%d systems as bellman (%d feasible)\n", same, systems, feasible);
+}
+
+//Test verify_retiming with and without WD on opt2 results, and on the results with a vertex moved
+void test_verify(int n, int vertex_count) {
+    printf("--- Verifying %d retimings of graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count);
+        WDEntry* WD = wd(graph);
+        OptResult result = opt2(graph, WD);
+        if(!result.r) {
+            printf("No retiming found\n");
+            free(graph.vertices);
+            free(graph.edges);
+            free(WD);
+            continue;
+        }
+
+        VerifyResult with_wd = verify_retiming(graph, result.graph, result.c, WD, 4);
+        VerifyResult without_wd = verify_retiming(graph, result.graph, result.c);
+        printf("C: %d\tPeriod: %d\tLegal: %d (check_legal %d)\tLegal without WD: %d\n", result.c, with_wd.period, with_wd.r,
+                check_legal(graph, result.graph, result.c, WD), without_wd.r);
+
+        //move vertex 0 vertex_count registers without updating its edges
+        result.graph.vertices[0].weight += vertex_count;
+        with_wd = verify_retiming(graph, result.graph, result.c, WD, 4);
+        printf("Moved vertex - Legal: %d\tW1: %lld\t7.1: %lld\t7.2: %lld\n", with_wd.r, with_wd.w1_violations,
+                with_wd.c7_1_violations, with_wd.c7_2_violations);
+
+        free(result.graph.vertices);
+        free(result.graph.edges);
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test run_batch on random circuit files against opt2
+void test_batch(int n, int vertex_count) {
+    printf("--- Batch of %d graphs with %d vertex ---\n", n, vertex_count);
+    std::vector<std::string> paths;
+    std::vector<int> expected;
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count + i);
+        paths.push_back("batch_" + std::to_string(i) + ".graph");
+        write_graph(graph, paths.back());
+
+        WDEntry* WD = wd(graph);
+        OptResult result = opt2(graph, WD);
+        expected.push_back(result.c);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+
+    BatchOptions options;
+    options.thread_count = 3;
+    for(BatchAlgorithm algorithm: {BATCH_AUTO, BATCH_OPT1, BATCH_OPT2}) {
+        options.algorithm = algorithm;
+        std::vector<BatchJobResult> results = run_batch(paths, options);
+        int same = 0;
+        for(int i = 0; i < n; ++i) {
+            if(results[i].r && results[i].c == expected[i]) ++same;
+        }
+        printf("%s: %d/%d retimed with the OPT2 clock period\n", batch_algorithm_names[algorithm], same, n);
+    }
+
+    //a corrupt file only fails its own job
+    Vertex corrupt_vertices[2] = {Vertex(1), Vertex(1)};
+    Edge corrupt_edges[1] = {Edge(1, 100000000, 1)};
+    Graph corrupt(corrupt_vertices, corrupt_edges, 2, 1);
+    paths.push_back("batch_corrupt.graph");
+    write_graph(corrupt, paths.back());
+    std::vector<BatchJobResult> results = run_batch(paths, options);
+    int retimed = 0;
+    for(int i = 0; i < n; ++i) {
+        if(results[i].r) ++retimed;
+    }
+    printf("Corrupt file: %s\tOthers retimed: %d/%d\n", results[n].r ? "retimed" : results[n].error.c_str(), retimed, n);
+
+    for(std::string &path: paths) {
+        remove(path.c_str());
+    }
+}
+
+//Test the trace of opt1 and opt2 on a random graph: phase times, counters, and the probes written as JSON and CSV
+void test_trace(int vertex_count) {
+    printf("--- Trace of opt1 and opt2 on a graph with %d vertex ---\n", vertex_count);
+    Graph graph = generate_circuit(vertex_count);
+    reset_trace();
+    WDEntry* WD = wd<TraceInstrument>(graph);
+    OptResult result1 = opt1<TraceInstrument>(graph, WD);
+    OptResult result2 = opt2<TraceInstrument>(graph, WD);
+    printf("C opt1: %d\tC opt2: %d\n", result1.c, result2.c);
+
+    Trace &trace = retiming_trace;
+    for(TracePhase &phase: trace.phases) {
+        printf("%-18s %10.3f ms\t%lld calls\n", phase.name, phase.time, phase.calls);
+    }
+    for(int i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+        printf("%-20s %lld\n", trace_counter_names[i], trace.counters[i]);
+    }
+    for(TraceProbe &probe: trace.probes) {
+        printf("[%s] b: %d\tbot: %d\ttop: %d\tc: %d\tfeasible: %d\tresult c: %d\n", probe.algorithm, probe.b, probe.bot, probe.top,
+                probe.c, probe.feasible, probe.result_c);
+    }
+    printf("JSON written: %d\tCSV written: %d\n", write_trace_json("trace.json"), write_trace_csv("trace.csv"));
+    remove("trace.json");
+    remove("trace.csv");
+
+    if(result1.r) {
+        free(result1.graph.vertices);
+        free(result1.graph.edges);
+    }
+    if(result2.r) {
+        free(result2.graph.vertices);
+        free(result2.graph.edges);
+    }
+    free(graph.vertices);
+    free(graph.edges);
+    free(WD);
+}
+
+//Test opt2 with the space and time instrumentation on their own threads while an uninstrumented opt2 runs on this one
+void test_instrument(int vertex_count) {
+    printf("--- Instrumented opt2 on a graph with %d vertex ---\n", vertex_count);
+    Graph graph = generate_circuit(vertex_count);
+    WDEntry* WD = wd(graph);
+
+    OptResult space_result, time_result;
+    size_t max_heap = 0;
+    std::vector<TracePhase> times;
+    std::thread space_thread([&]() {
+        SpaceBench *space_bench = SpaceInstrument::reset();
+        space_result = opt2<SpaceInstrument>(graph, WD);
+        max_heap = space_bench->max_heap;
+    });
+    std::thread time_thread([&]() {
+        reset_trace();
+        time_result = opt2<TraceInstrument>(graph, WD);
+        times = retiming_trace.phases;
+    });
+    OptResult result = opt2(graph, WD);
+    space_thread.join();
+    time_thread.join();
+
+    printf("C: %d\tC space: %d\tC time: %d\tMax heap: %zu bytes\n", result.c, space_result.c, time_result.c, max_heap);
+    for(TracePhase &entry: times) {
+        printf("%-18s %10.3f ms\t%lld calls\n", entry.name, entry.time, entry.calls);
+    }
+
+    for(OptResult *r: {&result, &space_result, &time_result}) {
+        if(r->r) {
+            free(r->graph.vertices);
+            free(r->graph.edges);
+        }
+    }
+    free(graph.vertices);
+    free(graph.edges);
+    free(WD);
+}
+
+//Test the service: repeated requests on the same circuits hit the WD cache, or read it back from the spill directory
+void test_service(int n, int vertex_count) {
+    printf("--- Service on %d graphs with %d vertex ---\n", n, vertex_count);
+    std::vector<std::vector<char>> circuits;
+    std::vector<int> expected;
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count + i);
+        write_graph(graph, "service.graph");
+        std::ifstream file("service.graph", std::ios::binary);
+        circuits.push_back(std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+
+        WDEntry* WD = wd(graph);
+        OptResult result = opt2(graph, WD);
+        expected.push_back(result.c);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+    remove("service.graph");
+
+    //room for the WD matrix of a single circuit, the others are spilled
+    ServiceOptions options;
+    options.thread_count = 2;
+    options.cache_bytes = (size_t) sizeof(WDEntry) * (vertex_count + n) * (vertex_count + n) * 3 / 2;
+    options.spill_dir = "service_spill";
+    std::mutex mutex;
+    std::vector<ServiceResponse> responses;
+    {
+        RetimingService service(options);
+        for(ServiceAlgorithm algorithm: {SERVICE_OPT2, SERVICE_OPT1, SERVICE_AUTO}) {
+            for(int i = 0; i < n; ++i) {
+                ServiceRequest request;
+                request.id = std::to_string(i);
+                request.algorithm = algorithm;
+                request.target_c = 0;
+                request.data = circuits[i];
+                request.respond = [&](ServiceResponse &response) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    responses.push_back(response);
+                };
+                service.submit(request);
+            }
+        }
+        service.stop();
+        printf("%s\n", format_service_stats(service.get_stats()).c_str());
+    }
+
+    int same = 0, sources[4] = {0, 0, 0, 0};
+    for(ServiceResponse &response: responses) {
+        if(response.r && response.c == expected[std::stoi(response.id)]) ++same;
+        ++sources[response.wd_source];
+    }
+    printf("%d/%zu retimed with the OPT2 clock period\tWD hit: %d\tspill: %d\tmiss: %d\n", same, responses.size(),
+            sources[WD_HIT], sources[WD_SPILL], sources[WD_MISS]);
+
+    DIR *dir = opendir(options.spill_dir.c_str());
+    if(dir) {
+        while(dirent *file = readdir(dir)) {
+            if(file->d_name[0] != '.') remove((options.spill_dir + "/" + file->d_name).c_str());
+        }
+        closedir(dir);
+        rmdir(options.spill_dir.c_str());
+    }
+
+    //one circuit asked again and again within the cache capacity: computed once, then served from memory
+    ServiceOptions memory_options;
+    memory_options.thread_count = 2;
+    responses.clear();
+    {
+        RetimingService service(memory_options);
+        for(ServiceAlgorithm algorithm: {SERVICE_OPT2, SERVICE_OPT1, SERVICE_AUTO, SERVICE_MIN_AREA, SERVICE_OPT2}) {
+            ServiceRequest request;
+            request.id = "0";
+            request.algorithm = algorithm;
+            request.target_c = expected[0];
+            request.data = circuits[0];
+            request.respond = [&](ServiceResponse &response) {
+                std::lock_guard<std::mutex> lock(mutex);
+                responses.push_back(response);
+            };
+            service.submit(request);
+        }
+        service.stop();
+        printf("%s\n", format_service_stats(service.get_stats()).c_str());
+    }
+    same = 0;
+    for(int &source: sources) source = 0;
+    for(ServiceResponse &response: responses) {
+        if(response.r && response.c == expected[0]) ++same;
+        ++sources[response.wd_source];
+    }
+    printf("Same circuit: %d/%zu retimed with the OPT2 clock period\tWD hit: %d\tspill: %d\tmiss: %d\n", same, responses.size(),
+            sources[WD_HIT], sources[WD_SPILL], sources[WD_MISS]);
+
+    //a WD matrix bigger than the cache is refused before it is allocated, FEAS needs none
+    ServiceOptions small_options;
+    small_options.thread_count = 1;
+    small_options.cache_bytes = sizeof(WDEntry);
+    responses.clear();
+    {
+        RetimingService service(small_options);
+        for(ServiceAlgorithm algorithm: {SERVICE_OPT2, SERVICE_FEAS}) {
+            ServiceRequest request;
+            request.id = service_algorithm_names[algorithm];
+            request.algorithm = algorithm;
+            request.target_c = expected[0];
+            request.data = circuits[0];
+            request.respond = [&](ServiceResponse &response) {
+                std::lock_guard<std::mutex> lock(mutex);
+                responses.push_back(response);
+            };
+            service.submit(request);
+        }
+        service.stop();
+    }
+    for(ServiceResponse &response: responses) {
+        printf("Cache of one entry, %s: r: %d\tc: %d\terror: %s\n", response.id.c_str(), response.r, response.c,
+                response.error.c_str());
+    }
+
+    //the wire protocol through pipes: requests in, responses out
+    int request_pipe[2], response_pipe[2];
+    if(pipe(request_pipe) != 0 || pipe(response_pipe) != 0) {
+        printf("Could not create the pipes\n");
+        return;
+    }
+    std::string size = std::to_string(circuits[0].size());
+    std::string data(circuits[0].begin(), circuits[0].end());
+    //header whose vertex section wraps around 2^64 back into the buffer
+    GraphFileHeader header = {};
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC));
+    header.version = GRAPH_FILE_VERSION;
+    header.vertex_count = 1 << 28;
+    header.vertices_offset = sizeof(GraphFileHeader) - sizeof(Vertex) * header.vertex_count;
+    header.edges_offset = sizeof(GraphFileHeader);
+    std::string wrapped((char *) &header, sizeof(GraphFileHeader));
+    wrapped.resize(216, 0);
+    std::string input = "a opt2 0 " + size + "\n" + data
+        + "b feas " + std::to_string(expected[0]) + " " + size + "\n" + data
+        + "c area 0 " + size + "\n" + data
+        + "e opt2 0 " + std::to_string(wrapped.size()) + "\n" + wrapped
+        + "stats\n"
+        + "d opt2 0 999999999999999\n";
+    std::thread writer([&]() {
+        for(size_t written = 0; written < input.size(); ) {
+            ssize_t count = write(request_pipe[1], input.data() + written, input.size() - written);
+            if(count <= 0) break;
+            written += count;
+        }
+        close(request_pipe[1]);
+    });
+    std::string output;
+    std::thread reader([&]() {
+        char buffer[4096];
+        ssize_t count;
+        while((count = read(response_pipe[0], buffer, sizeof(buffer))) > 0) output.append(buffer, count);
+    });
+    {
+        //the response end is closed once the last response is written
+        RetimingService service(memory_options);
+        serve_connection(service, request_pipe[0], std::make_shared<ServiceConnection>(response_pipe[1], true));
+        service.stop();
+    }
+    writer.join();
+    reader.join();
+    close(request_pipe[0]);
+    close(response_pipe[0]);
+
+    //ok responses without their latency and retiming, errors as they are, sorted as they may come out of order
+    std::istringstream lines(output);
+    std::vector<std::string> sorted_lines;
+    for(std::string line; std::getline(lines, line); ) {
+        sorted_lines.push_back(line);
+    }
+    std::sort(sorted_lines.begin(), sorted_lines.end());
+    for(std::string &line: sorted_lines) {
+        std::istringstream fields(line);
+        std::string id, status, algorithm, c, source;
+        fields >> id >> status >> algorithm >> c >> source;
+        if(id == "stats") printf("Protocol: stats\n");
+        else if(status == "ok") printf("Protocol: %s ok %s C: %s (OPT2 %d) WD: %s\n", id.c_str(), algorithm.c_str(), c.c_str(), expected[0], source.c_str());
+        else printf("Protocol: %s\n", line.c_str());
+    }
+}
+
+//Test eco_reopt on random edits of a circuit against WD and opt2 from scratch
+void test_eco(int n, int vertex_count) {
+    printf("--- %d ECOs of a graph with %d vertex ---\n", n, vertex_count);
+    std::mt19937 gen(7);
+    Graph graph = generate_circuit(vertex_count, 7);
+    WDEntry* WD = wd(graph);
+    OptResult previous = opt2(graph, WD);
+
+    for(int i = 0; i < n; ++i) {
+        //a changed delay or one register more or less
+        std::vector<EcoEdit> edits;
+        if(i % 3 == 0) {
+            edits.push_back({ECO_DELAY, (int) (gen() % vertex_count), (int) (gen() % 20) + 1});
+        } else {
+            int e = gen() % graph.edge_count;
+            int weight = graph.edges[e].weight;
+            edits.push_back({ECO_REGISTERS, e, i % 3 == 1 || weight == 0 ? weight + 1 : weight - 1});
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        EcoStats stats;
+        OptResult result = eco_reopt(graph, WD, previous, edits, &stats);
+        double eco_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        if(!result.r) {
+            printf("Edit rejected (0 weight cycle)\n");
+            continue;
+        }
+
+        begin = std::chrono::steady_clock::now();
+        WDEntry* full_WD = wd(graph);
+        OptResult full = opt2(graph, full_WD);
+        double full_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        int wrong_entries = 0;
+        for(int k = 0; k < vertex_count * vertex_count; ++k) {
+            if(WD[k].W != full_WD[k].W || WD[k].D != full_WD[k].D) ++wrong_entries;
+        }
+        printf("%s %d -> %d\tC: %d (opt2 %d)\tLegal: %d\tWD entries wrong: %d\tRows: %d\tEntries: %lld\tProbes: %d\tTime: %.2f ms (opt2 %.2f ms)\n",
+                edits[0].type == ECO_DELAY ? "Delay" : "Registers", edits[0].id, edits[0].value, result.c, full.c,
+                check_legal(graph, result.graph, result.c, full_WD), wrong_entries, stats.repaired_rows, stats.repaired_entries, stats.probes,
+                eco_time, full_time);
+
+        if(previous.r) {
+            free(previous.graph.vertices);
+            free(previous.graph.edges);
+        }
+        previous = result;
+        if(full.r) {
+            free(full.graph.vertices);
+            free(full.graph.edges);
+        }
+        free(full_WD);
+    }
+
+    if(previous.r) {
+        free(previous.graph.vertices);
+        free(previous.graph.edges);
+    }
+    free(graph.vertices);
+    free(graph.edges);
+    free(WD);
+}
+
+//Test opt1_sweep against opt1 on random graphs and rings (optimum far from the maximum vertex delay)
+void test_opt1_sweep(int n, int vertex_count) {
+    printf("--- opt1_sweep on %d graphs with %d vertex ---\n", 2*n, vertex_count);
+    for(int i = 0; i < 2*n; ++i) {
+        Graph graph = i < n ? generate_circuit(vertex_count, i) : generate_ring_circuit(vertex_count, 3 + i, i);
+        WDEntry* WD = wd(graph);
+
+        auto begin = std::chrono::steady_clock::now();
+        OptResult result = opt1(graph, WD);
+        double opt1_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        begin = std::chrono::steady_clock::now();
+        OptResult sweep = opt1_sweep(graph, WD);
+        double sweep_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        printf("%s\tOPT1 C: %d\tSweep C: %d\tLegal: %d\tTime: %.2f ms (opt1 %.2f ms)\n", i < n ? "random" : "ring", result.c,
+                sweep.c, sweep.r && check_legal(graph, sweep.graph, sweep.c, WD), sweep_time, opt1_time);
+
+        for(OptResult *r: {&result, &sweep}) {
+            if(r->r) {
+                free(r->graph.vertices);
+                free(r->graph.edges);
+            }
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test bellman_parallel against bellman on the OPT1 constraints of random graphs, at the optimum and below it
+void test_bellman_parallel(int n, int vertex_count) {
+    printf("--- Parallel bellman on %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count, i);
+        WDEntry* WD = wd(graph);
+        OptResult result = opt1(graph, WD);
+        OptResult parallel_result = opt1(graph, WD, 4);
+
+        for(int c: {result.c, result.c - 1}) {
+            std::vector<Edge> opt_edges;
+            add_7_1_edges(graph, opt_edges);
+            add_7_2_edges(graph, WD, c, opt_edges);
+            Graph opt_graph(graph.vertices, &opt_edges[0], vertex_count, opt_edges.size());
+
+            std::vector<int> distance(vertex_count+1);
+            bool r = bellman(opt_graph, &distance[0]);
+            printf("C: %d\tFeasible: %d", c, r);
+            for(int threads: {1, 2, 4}) {
+                std::vector<int> parallel_distance(vertex_count+1);
+                bool parallel_r = bellman_parallel(opt_graph, &parallel_distance[0], threads);
+                printf("\t%d threads: %d%s", threads, parallel_r, !r || parallel_distance == distance ? "" : " (different distances)");
+            }
+            printf("\n");
+        }
+        printf("OPT1 C: %d\tOPT1 with 4 threads C: %d\n", result.c, parallel_result.c);
+
+        for(OptResult *r: {&result, &parallel_result}) {
+            if(r->r) {
+                free(r->graph.vertices);
+                free(r->graph.edges);
+            }
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test opt1 and opt2 on reordered random circuits against the original ones, with the retimings mapped back
+void test_reorder(int n, int vertex_count) {
+    printf("--- Testing reordering on %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count, i);
+        WDEntry* WD = wd(graph);
+        std::vector<int> deltas(vertex_count);
+        int c = cp(graph, &deltas[0]);
+        OptResult result = opt2(graph, WD);
+        printf("CIRCUIT %d: CP: %d\tOPT2 C: %d\n", i, c, result.c);
+
+        for(ReorderMethod method: {REORDER_LEVELS, REORDER_RCM}) {
+            ReorderedGraph reordered = reorder_graph(graph, method);
+            WDEntry* reordered_WD = wd(reordered.graph);
+
+            std::vector<int> reordered_deltas(vertex_count), restored_deltas(vertex_count);
+            int reordered_c = cp(reordered.graph, &reordered_deltas[0]);
+            restore_vertex_order(reordered, &reordered_deltas[0], &restored_deltas[0]);
+
+            OptResult opt1_result = opt1(reordered.graph, reordered_WD);
+            OptResult opt2_result = opt2(reordered.graph, reordered_WD);
+            bool legal = opt1_result.r && opt2_result.r;
+            for(OptResult *r: {&opt1_result, &opt2_result}) {
+                if(!r->r) continue;
+                Graph retimed = restore_retiming(reordered, graph, r->graph);
+                legal = legal && check_legal(graph, retimed, r->c, WD);
+                free(retimed.vertices);
+                free(retimed.edges);
+                free(r->graph.vertices);
+                free(r->graph.edges);
+            }
+            printf("%s\tCP: %d%s\tOPT1 C: %d\tOPT2 C: %d\tLegal: %d\n", reorder_method_names[method], reordered_c,
+                    restored_deltas == deltas ? "" : " (different deltas)", opt1_result.c, opt2_result.c, legal);
+
+            free_reordered_graph(reordered);
+            free(reordered_WD);
+        }
+
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test min_area on random circuits, at the OPT2 clock period and at the initial one, with and without shared fanouts
+void test_min_area(int n, int vertex_count) {
+    printf("--- min_area on %d graphs with %d vertex ---\n", n, vertex_count);
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count, i);
+        WDEntry* WD = wd(graph);
+        std::vector<int> deltas(vertex_count);
+        int initial_c = cp(graph, &deltas[0]);
+        OptResult result = opt2(graph, WD);
+        if(!result.r) {
+            printf("No retiming found\n");
+            free(graph.vertices);
+            free(graph.edges);
+            free(WD);
+            continue;
+        }
+
+        for(bool share_fanout: {false, true}) {
+            for(int c: {result.c, initial_c}) {
+                //registers of the retiming min_area has to beat: opt2 at its period, the circuit as it is at its own
+                long long bound = register_count(c == result.c ? result.graph : graph, share_fanout);
+                OptResult area = min_area(graph, WD, c, share_fanout);
+                if(!area.r) {
+                    printf("%s\tC: %d\tNo retiming found\n", share_fanout ? "shared" : "edges", c);
+                    continue;
+                }
+                Graph retimed(graph.vertices, area.graph.edges, vertex_count, graph.edge_count);
+                int area_c = cp(retimed, &deltas[0]);
+                long long registers = register_count(area.graph, share_fanout);
+                printf("%s\tC: %d\tLegal: %d\tCP: %d\tRegisters: %lld (at most %lld)%s\n", share_fanout ? "shared" : "edges",
+                        c, check_legal(graph, area.graph, c, WD), area_c, registers, bound,
+                        area_c <= c && registers <= bound ? "" : " (WRONG)");
+                free(area.graph.vertices);
+                free(area.graph.edges);
+            }
+        }
+
+        free(result.graph.vertices);
+        free(result.graph.edges);
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test the 0 weight cycle finder on random circuits with and without planted cycles, and its message in a batch job
+void test_zero_weight_cycles(int n, int vertex_count) {
+    printf("--- 0 weight cycles of %d graphs with %d vertex ---\n", n, vertex_count);
+    //every witness is a closed path of 0 weight edges
+    auto valid = [](std::vector<std::vector<Edge *>> &cycles) {
+        for(std::vector<Edge *> &cycle: cycles) {
+            if(cycle.empty()) return false;
+            for(int k = 0; k < (int) cycle.size(); ++k) {
+                if(cycle[k]->weight != 0 || cycle[k]->to != cycle[(k+1) % cycle.size()]->from) return false;
+            }
+        }
+        return true;
+    };
+
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count, i);
+        std::vector<std::vector<Edge *>> cycles;
+        find_zero_weight_cycles(&cycles, graph);
+        int generated = cycles.size();
+
+        //close a 0 weight edge into a cycle with its reverse
+        std::vector<Edge> edges(graph.edges, graph.edges + graph.edge_count);
+        for(Edge &edge: edges) {
+            if(edge.weight == 0 && edge.from != edge.to) {
+                edges.push_back(Edge(edge.to, edge.from, 0));
+                break;
+            }
+        }
+        Graph planted(graph.vertices, &edges[0], vertex_count, edges.size());
+        cycles.clear();
+        find_zero_weight_cycles(&cycles, planted);
+        printf("Generated cycles: %d\tPlanted cycles: %d\tValid: %d\t%s\n", generated, (int) cycles.size(), valid(cycles),
+                zero_weight_cycle_message(planted, 4).c_str());
+
+        free(graph.vertices);
+        free(graph.edges);
+    }
+
+    //a netlist with a combinational path from an input to an output and no host registers
+    std::ofstream bench_file("cycle.bench");
+    bench_file << "INPUT(A)\nOUTPUT(C)\nB = NOT(A)\nC = AND(B, D)\nD = DFF(C)\n";
+    bench_file.close();
+    BatchOptions options;
+    options.thread_count = 1;
+    options.netlist_options.host_registers = 0;
+    std::vector<std::string> paths = {"cycle.bench"};
+    std::vector<BatchJobResult> results = run_batch(paths, options);
+    printf("Batch without host registers: %s\n", results[0].r ? "retimed" : results[0].error.c_str());
+    remove("cycle.bench");
+}
+
+//Test period_lower_bound on a ring with a known cycle ratio, and against the optimum of random circuits searched without it
+void test_period_lower_bound(int n, int vertex_count) {
+    printf("--- Period lower bound of a ring and of %d graphs with %d vertex ---\n", n, vertex_count);
+    //delay 15 around 2 registers: ratio 7.5, so no period below 8, reached by moving a register to split 3 5 | 4 3
+    Vertex ring_vertices[4] = {Vertex(3), Vertex(5), Vertex(4), Vertex(3)};
+    Edge ring_edges[4] = {Edge(0, 1, 1), Edge(1, 2, 1), Edge(2, 3, 0), Edge(3, 0, 0)};
+    Graph ring(ring_vertices, ring_edges, 4, 4);
+    CycleRatioResult ratio = max_cycle_ratio(ring);
+    WDEntry* ring_WD = wd(ring);
+    OptResult ring_result = opt2(ring, ring_WD);
+    printf("Ring: ratio %.2f (%d / %d)\tLower bound: %d\tOPT2 C: %d%s\n", ratio.ratio, ratio.delay, ratio.registers,
+            ratio.lower_bound, ring_result.c, ratio.ratio == 7.5 && ratio.delay == 15 && ratio.registers == 2
+            && ratio.lower_bound == 8 && period_lower_bound(ring) == 8 && ring_result.c == 8 ? "" : " (WRONG)");
+    if(ring_result.r) {
+        free(ring_result.graph.vertices);
+        free(ring_result.graph.edges);
+    }
+    free(ring_WD);
+
+    for(int i = 0; i < n; ++i) {
+        Graph graph = generate_circuit(vertex_count, i);
+        WDEntry* WD = wd(graph);
+        int lower_bound = period_lower_bound(graph);
+
+        //binary search of every candidate with FEAS, none skipped by the bound
+        int c_count;
+        int *c_candidates = get_c_candidates(graph, WD, &c_count, 0);
+        std::vector<int> deltas(vertex_count);
+        int unbounded_c = -1;
+        int bot = 0;
+        int top = c_count-1;
+        while(bot <= top) {
+            int b = (top + bot)/2;
+            FeasResult feas_result = feas(graph, c_candidates[b], &deltas[0]);
+            if(feas_result.r) {
+                unbounded_c = c_candidates[b];
+                top = b - 1;
+            } else {
+                bot = b + 1;
+            }
+            free(feas_result.graph.vertices);
+            free(feas_result.graph.edges);
+        }
+
+        OptResult result = opt2(graph, WD);
+        printf("Lower bound: %d\tOPT without bound C: %d\tOPT2 C: %d%s\n", lower_bound, unbounded_c, result.c,
+                lower_bound <= unbounded_c && result.c == unbounded_c ? "" : " (WRONG)");
+
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(c_candidates);
+        free(graph.vertices);
+        free(graph.edges);
+        free(WD);
+    }
+}
+
+//Test the circuit families: no 0 weight cycles at any size, and the correlator of 4 taps being the one of the retiming paper
+void test_circuit_families() {
+    printf("--- Circuit families ---\n");
+    for(int f = 0; f < circuit_family_count; ++f) {
+        int cycle_free = 0;
+        for(int size_log = 2; size_log <= 12; ++size_log) {
+            Graph graph = generate_family_circuit((CircuitFamily) f, size_log, size_log);
+            std::vector<std::vector<Edge *>> cycles;
+            find_zero_weight_cycles(&cycles, graph);
+            std::vector<int> deltas(graph.vertex_count);
+            if(cycles.empty() && cp(graph, &deltas[0]) >= 0) ++cycle_free;
+            free(graph.vertices);
+            free(graph.edges);
+        }
+        printf("%s: %d/11 sizes without 0 weight cycles%s\n", circuit_family_names[f], cycle_free, cycle_free == 11 ? "" : " (WRONG)");
+    }
+
+    //correlator1 of test_opt2, edges in any order
+    Vertex vertices[] = {Vertex(0), Vertex(3), Vertex(3), Vertex(3), Vertex(3), Vertex(7), Vertex(7), Vertex(7)};
+    Edge edges[] = {
+        Edge(0, 1, 1), Edge(1, 2, 1), Edge(1, 7, 0), Edge(2, 3, 1), Edge(2, 6, 0), Edge(3, 4, 1),
+        Edge(3, 5, 0), Edge(4, 5, 0), Edge(5, 6, 0), Edge(6, 7, 0), Edge(7, 0, 0),
+    };
+    Graph correlator = generate_family_circuit(CORRELATOR, 3);
+    auto edge_less = [](const Edge &a, const Edge &b) {
+        return a.from != b.from ? a.from < b.from : a.to != b.to ? a.to < b.to : a.weight < b.weight;
+    };
+    std::vector<Edge> expected(edges, edges + 11);
+    std::vector<Edge> generated(correlator.edges, correlator.edges + correlator.edge_count);
+    std::sort(expected.begin(), expected.end(), edge_less);
+    std::sort(generated.begin(), generated.end(), edge_less);
+    bool same = correlator.vertex_count == 8 && correlator.edge_count == 11;
+    for(int i = 0; same && i < 8; ++i) {
+        same = correlator.vertices[i].weight == vertices[i].weight;
+    }
+    for(int i = 0; same && i < 11; ++i) {
+        same = generated[i].from == expected[i].from && generated[i].to == expected[i].to && generated[i].weight == expected[i].weight;
+    }
+    WDEntry* WD = wd(correlator);
+    OptResult result = opt2(correlator, WD);
+    printf("Correlator of 4 taps: same as correlator1: %d\tOPT2 C: %d%s\n", same, result.c, same && result.c == 13 ? "" : " (WRONG)");
+
+    if(result.r) {
+        free(result.graph.vertices);
+        free(result.graph.edges);
+    }
+    free(correlator.vertices);
+    free(correlator.edges);
+    free(WD);
+}
+
+//Test critical_edges and to_dot_subgraph on correlator1, whose critical path is 3, 4 -> 5 -> 6 -> 7 -> 0 (CP 24)
+void test_critical_subgraph() {
+    printf("--- Critical subgraph of correlator1 ---\n");
+    Vertex vertices[] = {Vertex(0), Vertex(3), Vertex(3), Vertex(3), Vertex(3), Vertex(7), Vertex(7), Vertex(7)};
+    Edge edges[] = {
+        Edge(0, 1, 1), Edge(1, 2, 1), Edge(1, 7, 0), Edge(2, 3, 1), Edge(2, 6, 0), Edge(3, 4, 1),
+        Edge(3, 5, 0), Edge(4, 5, 0), Edge(5, 6, 0), Edge(6, 7, 0), Edge(7, 0, 0),
+    };
+    Graph graph(vertices, edges, 8, 11);
+
+    std::vector<int> critical = critical_edges(graph);
+    std::sort(critical.begin(), critical.end());
+    bool same_edges = critical == std::vector<int>({6, 7, 8, 9, 10});
+
+    //vertices in the order the edges reach them, every edge red (0 weight)
+    to_dot_subgraph(graph, "critical.dot", critical);
+    std::ifstream dot_file("critical.dot");
+    std::stringstream dot;
+    dot << dot_file.rdbuf();
+    dot_file.close();
+    std::string expected = std::string(DOT_HEADER);
+    int expected_vertices[][2] = {{3, 3}, {5, 7}, {4, 3}, {6, 7}, {7, 7}, {0, 0}};
+    for(auto &vertex: expected_vertices) {
+        expected += std::to_string(vertex[0]) + "[label=\"(" + std::to_string(vertex[0]) + ", " + std::to_string(vertex[1]) + ")\" , color = \"black\"]\n";
+    }
+    for(int e: {6, 7, 8, 9, 10}) {
+        expected += std::to_string(edges[e].from) + " -> " + std::to_string(edges[e].to) + "[label=\"0\" , color = \"red\"]\n";
+    }
+    expected += "}";
+    remove("critical.dot");
+
+    printf("Critical edges: %d\tSame edges: %d\tSame dot: %d%s\n", (int) critical.size(), same_edges, dot.str() == expected,
+            same_edges && dot.str() == expected ? "" : " (WRONG)");
+}
+
 int main() {
     printf("------------ TEST FEAS ------------\n");
     test_feas();
@@ -401,5 +1533,64 @@ int main() {
 
     printf("\n\n------------ TEST N RANDOM ------------\n");
     test_n_random(5, 500);
-}
 
+    printf("\n\n------------ TEST ANYTIME ------------\n");
+    test_anytime(3, 400);
+
+    printf("\n\n------------ TEST PERIOD LOWER BOUND ------------\n");
+    test_period_lower_bound(4, 400);
+
+    printf("\n\n------------ TEST REDUCTION ------------\n");
+    test_reduction(5, 500);
+
+    printf("\n\n------------ TEST MIN AREA ------------\n");
+    test_min_area(3, 300);
+
+    printf("\n\n------------ TEST MULTILEVEL ------------\n");
+    test_multilevel(5, 1000);
+
+    printf("\n\n------------ TEST CIRCUIT FILE ------------\n");
+    test_circuit_file(1<<17, 42);
+
+    printf("\n\n------------ TEST CIRCUIT FAMILIES ------------\n");
+    test_circuit_families();
+
+    printf("\n\n------------ TEST NETLIST ------------\n");
+    test_netlist();
+
+    printf("\n\n------------ TEST CRITICAL SUBGRAPH ------------\n");
+    test_critical_subgraph();
+
+    printf("\n\n------------ TEST CIRCUIT VIEW ------------\n");
+    test_circuit_view(5, 500);
+
+    printf("\n\n------------ TEST VERIFY ------------\n");
+    test_verify(5, 500);
+
+    printf("\n\n------------ TEST BATCH ------------\n");
+    test_batch(8, 300);
+
+    printf("\n\n------------ TEST ZERO WEIGHT CYCLES ------------\n");
+    test_zero_weight_cycles(3, 300);
+
+    printf("\n\n------------ TEST TRACE ------------\n");
+    test_trace(300);
+
+    printf("\n\n------------ TEST INSTRUMENT ------------\n");
+    test_instrument(300);
+
+    printf("\n\n------------ TEST SERVICE ------------\n");
+    test_service(4, 300);
+
+    printf("\n\n------------ TEST ECO ------------\n");
+    test_eco(12, 1000);
+
+    printf("\n\n------------ TEST OPT1 SWEEP ------------\n");
+    test_opt1_sweep(4, 500);
+
+    printf("\n\n------------ TEST PARALLEL BELLMAN ------------\n");
+    test_bellman_parallel(3, 400);
+
+    printf("\n\n------------ TEST REORDER ------------\n");
+    test_reorder(3, 500);
+}
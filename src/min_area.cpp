@@ -0,0 +1,310 @@
+#ifndef MINAREAALG
+#define MINAREAALG
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "types.h"
+#include "opt.cpp"
+
+//#define MINAREADEBUG
+
+#ifdef MINAREADEBUG
+#include <iostream>
+#endif
+
+/**
+ * Min cost flow network over the difference constraints r(y) - r(x) <= b, each one being an arc x -> y with cost b.
+ * Arcs are stored by tail with their reverse arc next to them (forward arc 2k, reverse arc 2k+1).
+ */
+struct FlowNetwork {
+    int node_count;
+    std::vector<long long> supply; //outflow - inflow required at each node
+    std::vector<int> tail, head;
+    std::vector<long long> cost, residual;
+
+    FlowNetwork(int node_count): node_count(node_count), supply(node_count, 0) {}
+
+    void add_arc(int from, int to, long long arc_cost) {
+        tail.push_back(from); head.push_back(to); cost.push_back(arc_cost); residual.push_back(0);
+        tail.push_back(to); head.push_back(from); cost.push_back(-arc_cost); residual.push_back(0);
+    }
+};
+
+/**
+ * COST SCALING MIN COST FLOW (Goldberg-Tarjan push-relabel)
+ * Arcs are uncapacitated. An acyclic optimal flow carries at most the total supply on any arc, so that is used as capacity.
+ * Costs are scaled by node_count+1, so the final 1-optimal flow is optimal.
+ * potential: array of node_count size where the optimal node potentials (dual solution) are stored,
+ * they satisfy potential[y] <= potential[x] + b for every arc and are tight on arcs with flow.
+ * Returns false if there is no bounded solution (negative cycle of constraints).
+ */
+bool min_cost_flow(FlowNetwork &network, long long *potential) {
+    int n = network.node_count;
+    int arc_count = network.tail.size();
+    long long scale = n + 1;
+
+    //arcs of each node, by tail
+    std::vector<int> offsets(n+1, 0);
+    for (int a = 0; a < arc_count; ++a) {
+        ++offsets[network.tail[a]+1];
+    }
+    for (int v = 0; v < n; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> arcs(arc_count);
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int a = 0; a < arc_count; ++a) {
+            arcs[position[network.tail[a]]++] = a;
+        }
+    }
+
+    long long capacity = 0;
+    for (int v = 0; v < n; ++v) {
+        if(network.supply[v] > 0) capacity += network.supply[v];
+    }
+
+    std::vector<long long> scaled_cost(arc_count);
+    long long max_cost = 1;
+    for (int a = 0; a < arc_count; ++a) {
+        scaled_cost[a] = network.cost[a] * scale;
+        max_cost = std::max(max_cost, std::abs(scaled_cost[a]));
+        network.residual[a] = (a & 1) ? 0 : capacity;
+    }
+
+    std::vector<long long> price(n, 0);
+    std::vector<long long> excess(network.supply.begin(), network.supply.end());
+    std::vector<int> current(n);
+    std::deque<int> active;
+    std::vector<bool> is_active(n, false);
+
+    auto push = [&](int a, long long amount) {
+        network.residual[a] -= amount;
+        network.residual[a ^ 1] += amount;
+        excess[network.tail[a]] -= amount;
+        excess[network.head[a]] += amount;
+    };
+
+    long long eps = max_cost;
+    while(eps > 1) {
+        eps = std::max(1LL, eps / 8);
+
+        //saturate every arc with negative reduced cost, the pseudoflow is then 0-optimal
+        for (int a = 0; a < arc_count; ++a) {
+            if(network.residual[a] > 0 && scaled_cost[a] + price[network.tail[a]] - price[network.head[a]] < 0)
+                push(a, network.residual[a]);
+        }
+
+        for (int v = 0; v < n; ++v) {
+            current[v] = offsets[v];
+            if(excess[v] > 0 && !is_active[v]) {
+                is_active[v] = true;
+                active.push_back(v);
+            }
+        }
+
+        //discharge active nodes
+        while(!active.empty()) {
+            int v = active.front();
+            active.pop_front();
+            is_active[v] = false;
+
+            while(excess[v] > 0) {
+                if(current[v] == offsets[v+1]) {
+                    //relabel: lower the price just enough to make an arc admissible
+                    long long best = std::numeric_limits<long long>::min();
+                    for (int i = offsets[v]; i < offsets[v+1]; ++i) {
+                        int a = arcs[i];
+                        if(network.residual[a] > 0)
+                            best = std::max(best, price[network.head[a]] - scaled_cost[a]);
+                    }
+                    price[v] = best - eps;
+                    current[v] = offsets[v];
+                }
+
+                int a = arcs[current[v]];
+                int w = network.head[a];
+                if(network.residual[a] > 0 && scaled_cost[a] + price[v] - price[w] < 0) {
+                    push(a, std::min(excess[v], network.residual[a]));
+                    if(excess[w] > 0 && !is_active[w]) {
+                        is_active[w] = true;
+                        active.push_back(w);
+                    }
+                } else {
+                    ++current[v];
+                }
+            }
+        }
+
+#ifdef MINAREADEBUG
+        printf("[Refine] eps: %lld\n", eps);
+#endif
+    }
+
+    //Exact potentials: shortest paths in the residual network, forward arcs being uncapacitated.
+    //The scaled prices are almost feasible already, so the relaxation converges quickly from them.
+    //A negative cycle shows as the path behind a potential reaching n arcs (a vertex can be relaxed many times per pass).
+    std::vector<int> path_arcs(n, 0);
+    std::deque<int> queue;
+    std::vector<bool> queued(n, true);
+    for (int v = 0; v < n; ++v) {
+        potential[v] = price[v] >= 0 ? price[v] / scale : -((-price[v] + scale - 1) / scale);
+        queue.push_back(v);
+    }
+    while(!queue.empty()) {
+        int v = queue.front();
+        queue.pop_front();
+        queued[v] = false;
+        for (int i = offsets[v]; i < offsets[v+1]; ++i) {
+            int a = arcs[i];
+            if(!(a & 1) || network.residual[a] > 0) {
+                int w = network.head[a];
+                if(potential[v] + network.cost[a] < potential[w]) {
+                    potential[w] = potential[v] + network.cost[a];
+                    path_arcs[w] = path_arcs[v] + 1;
+                    if(path_arcs[w] >= n) return false; //negative cycle
+                    if(!queued[w]) {
+                        queued[w] = true;
+                        queue.push_back(w);
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Amount of registers of a retimed graph.
+ * share_fanout: registers on the edges leaving the same vertex are shared, so each vertex counts the maximum of its edges.
+ */
+long long register_count(Graph &retimed, bool share_fanout) {
+    long long count = 0;
+    if(!share_fanout) {
+        for (int i = 0; i < retimed.edge_count; ++i) {
+            count += retimed.edges[i].weight;
+        }
+        return count;
+    }
+    std::vector<int> max_weight(retimed.vertex_count, 0);
+    for (int i = 0; i < retimed.edge_count; ++i) {
+        Edge edge = retimed.edges[i];
+        max_weight[edge.from] = std::max(max_weight[edge.from], edge.weight);
+    }
+    for (int v = 0; v < retimed.vertex_count; ++v) {
+        count += max_weight[v];
+    }
+    return count;
+}
+
+/**
+ * MIN AREA ALGORITHM
+ * Finds the retiming with clock period <= c that minimizes the amount of registers.
+ * Minimizes sum(w(e) + r(v) - r(u)) subject to the 7.1 and 7.2 constraints used by opt1, solving its dual
+ * as a min cost flow problem with cost scaling. The retiming is given by the optimal node potentials.
+ * share_fanout: registers on the edges leaving a vertex are shared (the vertex pays for its most retimed edge).
+ * Modeled with a mirror vertex m(u) for each vertex u with fanout k > 1, with edges v_i -> m(u) of weight wmax(u) - w(e_i),
+ * so that the registers of u are wmax(u) + r(m(u)) - r(u).
+ * Returns an OptResult with the retimed graph, r = false if c is not feasible.
+ */
+template<typename Instrument = NoInstrument>
+OptResult min_area(Graph &graph, WDEntry *WD, int c, bool share_fanout = true) {
+    Instrument::enter("min_area");
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    std::vector<int> fanout(vertex_count, 0);
+    std::vector<int> max_weight(vertex_count, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        ++fanout[edges[i].from];
+        max_weight[edges[i].from] = std::max(max_weight[edges[i].from], edges[i].weight);
+    }
+
+    //mirror vertices
+    std::vector<int> mirror(vertex_count, -1);
+    int node_count = vertex_count;
+    if(share_fanout) {
+        for (int v = 0; v < vertex_count; ++v) {
+            if(fanout[v] > 1) mirror[v] = node_count++;
+        }
+    }
+
+    //7.1 and 7.2 constraints, as built by opt1
+    std::vector<Edge> opt_edges;
+    add_7_1_edges(graph, opt_edges);
+    add_7_2_edges(graph, WD, c, opt_edges);
+
+    FlowNetwork network(node_count);
+    for (Edge edge: opt_edges) {
+        network.add_arc(edge.from, edge.to, edge.weight);
+    }
+
+    Instrument::allocated(sizeof(Edge) * opt_edges.size(), false, EDGE, "opt edges for 7.1 and 7.2");
+    opt_edges.clear();
+    opt_edges.shrink_to_fit();
+
+    //objective coefficients: each counted register adds r(v) - r(u)
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        if(mirror[from] >= 0) {
+            //r(v_i) - r(m(u)) <= wmax(u) - w(e_i)
+            network.add_arc(mirror[from], to, max_weight[from] - edges[i].weight);
+        } else {
+            network.supply[to] += 1;
+            network.supply[from] -= 1;
+        }
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        if(mirror[v] >= 0) {
+            network.supply[mirror[v]] += 1;
+            network.supply[v] -= 1;
+        }
+    }
+
+    Instrument::allocated((sizeof(int) * 2 + sizeof(long long) * 2) * network.tail.size(), false, EDGE, "flow network arcs");
+
+    long long *potential = (long long *) malloc(sizeof(long long) * node_count);
+    bool found = min_cost_flow(network, potential);
+
+#ifdef MINAREADEBUG
+    //strong duality: both objectives match at the optimum
+    long long primal = 0, dual = 0;
+    for (int v = 0; v < node_count; ++v) {
+        primal += network.supply[v] * potential[v];
+    }
+    for (int a = 0; a < (int) network.tail.size(); a += 2) {
+        dual -= network.cost[a] * network.residual[a+1];
+    }
+    printf("[Min area] primal: %lld, dual: %lld\n", primal, dual);
+#endif
+
+    Instrument::allocated(sizeof(long long) * node_count, false, INT, "potentials");
+    Instrument::leave();
+
+    if(!found) {
+        free(potential);
+        return {false, c, graph};
+    }
+
+    //Calculate r(v) for each vertex and edge weights of the retimed graph: wr(e) = w(e) + r(v) - r(u)
+    Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int i = 0; i < vertex_count; ++i) {
+        retimed_vertices[i] = Vertex(potential[i]);
+    }
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        retimed_edges[i] = Edge(from, to, edges[i].weight + retimed_vertices[to].weight - retimed_vertices[from].weight);
+    }
+
+    free(potential);
+
+    return {true, c, Graph(retimed_vertices, retimed_edges, vertex_count, edge_count)};
+}
+
+#endif
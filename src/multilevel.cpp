@@ -0,0 +1,353 @@
+#ifndef MULTILEVELALG
+#define MULTILEVELALG
+
+#include <vector>
+#include <algorithm>
+#include "types.h"
+#include "cp.cpp"
+#include "wd.cpp"
+#include "opt.cpp"
+#include "cycle_ratio.cpp"
+
+//#define MULTILEVELDEBUG
+
+#ifdef MULTILEVELDEBUG
+#include <iostream>
+#endif
+
+// One level of the coarsening hierarchy.
+struct CoarseLevel {
+    Graph graph; //coarse graph
+    int *map; //vertex of the finer graph -> vertex of this graph
+};
+
+struct MultilevelResult {
+    bool r; //retiming found
+    int c; //achieved clock period
+    int lower_bound; //lower bound of the optimal clock period
+    int levels; //amount of coarsening levels used
+    Graph graph; //retimed graph
+};
+
+/**
+ * Coarsens the graph by contracting a matching of heavily connected vertices.
+ * Each unmatched vertex is matched with the unmatched neighbour it shares the most edges with,
+ * ties broken in favour of the lighter pair.
+ * To keep the coarse graph free of 0 weight cycles, a pair (u, v) can only be contracted if:
+ * - u and v are on the same level of the 0 weight DAG (no 0 weight path between them), or
+ * - u -> v is a 0 weight edge, v is one level above u and u is the only 0 weight fanin of v.
+ * A contracted pair is retimed as a whole. Its delay is d(u) + d(v) if there is a zero weight edge between them,
+ * max(d(u), d(v)) otherwise, so that a retiming of the coarse graph is never worse on the finer graph.
+ * Parallel edges are reduced to the least weighted one.
+ */
+CoarseLevel coarsen(Graph &graph) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+    Vertex *vertices = graph.vertices;
+
+    //undirected adjacency, each edge appears in both of its endpoints
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        ++offsets[edges[i].from+1];
+        ++offsets[edges[i].to+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> neighbours(2 * edge_count);
+    std::vector<bool> zero_edge(2 * edge_count);
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int i = 0; i < edge_count; ++i) {
+            Edge edge = edges[i];
+            zero_edge[position[edge.from]] = edge.weight == 0;
+            neighbours[position[edge.from]++] = edge.to;
+            zero_edge[position[edge.to]] = edge.weight == 0;
+            neighbours[position[edge.to]++] = edge.from;
+        }
+    }
+
+    //level of each vertex in the 0 weight DAG (longest 0 weight path ending in it) and its only 0 weight fanin
+    std::vector<int> level(vertex_count, 0);
+    std::vector<int> zero_fanin(vertex_count, -1); //-1: none, -2: more than one
+    {
+        std::vector<int> zero_offsets(vertex_count+1, 0);
+        std::vector<int> zero_in_degree(vertex_count, 0);
+        for (int i = 0; i < edge_count; ++i) {
+            Edge edge = edges[i];
+            if(edge.weight != 0) continue;
+            ++zero_offsets[edge.from+1];
+            ++zero_in_degree[edge.to];
+            if(zero_fanin[edge.to] == -1)
+                zero_fanin[edge.to] = edge.from;
+            else if(zero_fanin[edge.to] != edge.from)
+                zero_fanin[edge.to] = -2;
+        }
+        for (int v = 0; v < vertex_count; ++v) {
+            zero_offsets[v+1] += zero_offsets[v];
+        }
+        std::vector<int> zero_targets(zero_offsets[vertex_count]);
+        std::vector<int> position(zero_offsets.begin(), zero_offsets.end()-1);
+        for (int i = 0; i < edge_count; ++i) {
+            if(edges[i].weight == 0) zero_targets[position[edges[i].from]++] = edges[i].to;
+        }
+
+        //Kahn's topological sort
+        std::vector<int> sorted;
+        for (int v = 0; v < vertex_count; ++v) {
+            if(zero_in_degree[v] == 0) sorted.push_back(v);
+        }
+        for (int k = 0; k < (int) sorted.size(); ++k) {
+            int u = sorted[k];
+            for (int i = zero_offsets[u]; i < zero_offsets[u+1]; ++i) {
+                int v = zero_targets[i];
+                level[v] = std::max(level[v], level[u] + 1);
+                if(--zero_in_degree[v] == 0) sorted.push_back(v);
+            }
+        }
+    }
+
+    //can u and v be contracted without creating a 0 weight cycle
+    auto contractible = [&](int u, int v) {
+        return level[u] == level[v] ||
+            (level[v] == level[u] + 1 && zero_fanin[v] == u) ||
+            (level[u] == level[v] + 1 && zero_fanin[u] == v);
+    };
+
+    int *map = (int *) malloc(sizeof(int) * vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        map[v] = -1;
+    }
+
+    std::vector<Vertex> coarse_vertices;
+    std::vector<int> connections(vertex_count, 0); //edges shared with the current vertex
+    std::vector<bool> zero_connection(vertex_count, false);
+    for (int u = 0; u < vertex_count; ++u) {
+        if(map[u] >= 0) continue;
+
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            ++connections[neighbours[i]];
+            if(zero_edge[i]) zero_connection[neighbours[i]] = true;
+        }
+
+        int match = -1;
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            int v = neighbours[i];
+            if(v == u || map[v] >= 0 || !contractible(u, v)) continue;
+            if(match < 0 || connections[v] > connections[match] ||
+                    (connections[v] == connections[match] && vertices[v].weight < vertices[match].weight)) {
+                match = v;
+            }
+        }
+
+        int weight = vertices[u].weight;
+        map[u] = coarse_vertices.size();
+        if(match >= 0) {
+            map[match] = map[u];
+            if(zero_connection[match])
+                weight += vertices[match].weight;
+            else
+                weight = std::max(weight, vertices[match].weight);
+        }
+        coarse_vertices.push_back(Vertex(weight));
+
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            connections[neighbours[i]] = 0;
+            zero_connection[neighbours[i]] = false;
+        }
+    }
+
+    //map edges, dropping the ones inside a contracted pair
+    std::vector<Edge> coarse_edges_v;
+    for (int i = 0; i < edge_count; ++i) {
+        int from = map[edges[i].from];
+        int to = map[edges[i].to];
+        if(from != to) coarse_edges_v.push_back(Edge(from, to, edges[i].weight));
+    }
+    std::sort(coarse_edges_v.begin(), coarse_edges_v.end(), [](const Edge &a, const Edge &b) {
+        if(a.from != b.from) return a.from < b.from;
+        if(a.to != b.to) return a.to < b.to;
+        return a.weight < b.weight;
+    });
+
+    int coarse_vertex_count = coarse_vertices.size();
+    Vertex *coarse_vertices_a = (Vertex *) malloc(sizeof(Vertex) * coarse_vertex_count);
+    std::copy(coarse_vertices.begin(), coarse_vertices.end(), coarse_vertices_a);
+
+    Edge *coarse_edges = (Edge *) malloc(sizeof(Edge) * coarse_edges_v.size());
+    int coarse_edge_count = 0;
+    for (int i = 0; i < (int) coarse_edges_v.size(); ++i) {
+        if(i > 0 && coarse_edges_v[i].from == coarse_edges_v[i-1].from && coarse_edges_v[i].to == coarse_edges_v[i-1].to)
+            continue;
+        coarse_edges[coarse_edge_count++] = coarse_edges_v[i];
+    }
+
+    return { Graph(coarse_vertices_a, coarse_edges, coarse_vertex_count, coarse_edge_count), map };
+}
+
+/**
+ * Local FEAS refinement.
+ * Runs up to passes FEAS iterations starting from the retiming r (vertex_count sized) instead of r = 0.
+ * Every iteration keeps the retiming legal, so r is a valid warm start.
+ * deltas: int array of vertex_count size to calculate CP algorithm
+ * r is only overwritten if a retiming with clock period <= target_c is found.
+ * Returns true if a retiming was found.
+ */
+bool refine(Graph &graph, int *r, int target_c, int passes, int *deltas) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    std::vector<int> tmp_r(r, r + vertex_count);
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        retimed_edges[i] = Edge(edges[i].from, edges[i].to, edges[i].weight + tmp_r[edges[i].to] - tmp_r[edges[i].from]);
+    }
+    Graph gr(graph.vertices, retimed_edges, vertex_count, edge_count);
+
+    bool found = false;
+    for (int pass = 0; pass <= passes; ++pass) {
+        if(cp(gr, deltas) <= target_c) {
+            found = true;
+            break;
+        }
+        if(pass == passes) break;
+
+        for (int v = 0; v < vertex_count; ++v) {
+            if(deltas[v] > target_c) ++tmp_r[v];
+        }
+        for (int i = 0; i < edge_count; ++i) {
+            retimed_edges[i].weight = edges[i].weight + tmp_r[edges[i].to] - tmp_r[edges[i].from];
+        }
+    }
+
+    if(found) std::copy(tmp_r.begin(), tmp_r.end(), r);
+
+    free(retimed_edges);
+    return found;
+}
+
+/**
+ * MULTILEVEL ALGORITHM
+ * Retiming for circuits too big for WD.
+ * - Coarsens the graph until it has at most coarsest_size vertices (or stops shrinking).
+ * - Solves the coarsest graph exactly with WD and OPT2.
+ * - Projects the retiming to each finer level and lowers its clock period with a binary search of local FEAS refinements
+ *   (refine_passes iterations per probe).
+ * Memory is O(V + E) except for the coarsest WD.
+ * Returns a MultilevelResult with the achieved clock period next to the lower bound of the optimal one.
+ */
+MultilevelResult multilevel(Graph &graph, int coarsest_size = 1024, int refine_passes = 32) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    //the clock period is at least the maximum cycle ratio and the delay of any vertex
+    int lower_bound = period_lower_bound(graph);
+
+    //coarsen
+    std::vector<CoarseLevel> levels;
+    Graph *current = &graph;
+    while(current->vertex_count > coarsest_size) {
+        CoarseLevel level = coarsen(*current);
+        if(level.graph.vertex_count > 0.9 * current->vertex_count) {
+            //matching stalled, coarsening further would not pay off
+            free(level.graph.vertices);
+            free(level.graph.edges);
+            free(level.map);
+            break;
+        }
+        levels.push_back(level);
+        current = &levels.back().graph;
+#ifdef MULTILEVELDEBUG
+        printf("[Coarsen] level %d: vertices: %d, edges: %d\n", (int) levels.size(), current->vertex_count, current->edge_count);
+#endif
+    }
+
+    //solve the coarsest level exactly
+    Graph &coarsest = levels.empty() ? graph : levels.back().graph;
+    int *r = (int *) malloc(sizeof(int) * coarsest.vertex_count);
+    {
+        WDEntry *WD = wd(coarsest);
+        OptResult result = opt2(coarsest, WD);
+        for (int v = 0; v < coarsest.vertex_count; ++v) {
+            r[v] = result.r ? result.graph.vertices[v].weight : 0;
+        }
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(WD);
+#ifdef MULTILEVELDEBUG
+        printf("[Coarsest] vertices: %d, c: %d\n", coarsest.vertex_count, result.c);
+#endif
+    }
+
+    //project and refine, level by level
+    int *deltas = (int *) malloc(sizeof(int) * vertex_count);
+    int c = -1;
+    for (int l = levels.size(); l >= 0; --l) {
+        Graph &fine = l > 0 ? levels[l-1].graph : graph;
+
+        if(l < (int) levels.size()) {
+            int *fine_r = (int *) malloc(sizeof(int) * fine.vertex_count);
+            int *map = levels[l].map;
+            for (int v = 0; v < fine.vertex_count; ++v) {
+                fine_r[v] = r[map[v]];
+            }
+            free(r);
+            r = fine_r;
+        }
+
+        //clock period of the projected retiming
+        refine(fine, r, MAXINT, 0, deltas);
+        c = 0;
+        for (int v = 0; v < fine.vertex_count; ++v) {
+            c = std::max(c, deltas[v]);
+        }
+
+        //binary search the lowest clock period reachable from the projection
+        int bot = lower_bound;
+        int top = c - 1;
+        while(bot <= top) {
+            int target_c = bot + (top - bot) / 2;
+            if(refine(fine, r, target_c, refine_passes, deltas)) {
+                c = 0;
+                for (int v = 0; v < fine.vertex_count; ++v) {
+                    c = std::max(c, deltas[v]);
+                }
+                top = c - 1;
+            } else {
+                bot = target_c + 1;
+            }
+        }
+#ifdef MULTILEVELDEBUG
+        printf("[Refine] level %d: vertices: %d, c: %d\n", l, fine.vertex_count, c);
+#endif
+    }
+
+    //build the retimed graph
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        retimed_edges[i] = Edge(from, to, edges[i].weight + r[to] - r[from]);
+    }
+    Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        retimed_vertices[v] = Vertex(r[v]);
+    }
+
+    for (CoarseLevel &level: levels) {
+        free(level.graph.vertices);
+        free(level.graph.edges);
+        free(level.map);
+    }
+    free(deltas);
+    free(r);
+
+    return { true, c, lower_bound, (int) levels.size(), Graph(retimed_vertices, retimed_edges, vertex_count, edge_count) };
+}
+
+#endif
@@ -0,0 +1,420 @@
+#ifndef NETLISTIMPORTER
+#define NETLISTIMPORTER
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <thread>
+#include <functional>
+#include "types.h"
+
+//#define NETLISTDEBUG
+
+#ifdef NETLISTDEBUG
+#include <iostream>
+#endif
+
+enum NetlistFormat { BENCH, BLIF };
+
+struct NetlistOptions {
+    std::map<std::string, int> gate_delays; //delay of each gate type (upper case, .names gates of BLIF are "NAMES")
+    int default_delay = 1; //delay of the gate types not in gate_delays
+    int host_registers = 1; //registers from the outputs back to the inputs
+    int thread_count = std::thread::hardware_concurrency();
+};
+
+struct NetlistResult {
+    bool r; //the netlist was imported
+    Graph graph;
+    std::vector<std::string> vertex_names; //output signal of each gate, "host" and "sink" for vertices 0 and 1
+    std::string error; //reason, if it was not imported
+};
+
+enum NetlistStatementKind { NETLIST_INPUT, NETLIST_OUTPUT, NETLIST_GATE, NETLIST_REGISTER };
+
+struct NetlistStatement {
+    NetlistStatementKind kind;
+    int type; //name id of the gate type
+    int output; //name id of the driven signal (the signal itself for inputs and outputs)
+    int input_begin, input_end; //range of input name ids in NetlistChunk::inputs
+};
+
+uint64_t netlist_name_hash(std::string_view name) {
+    uint64_t hash = 14695981039346656037ULL; //FNV-1a
+    for (char c: name) {
+        hash = (hash ^ (unsigned char) c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Open addressing table of names (views into the file), ids being their insertion order.
+struct NameTable {
+    std::vector<std::string_view> names;
+    std::vector<uint64_t> hashes;
+    std::vector<int> slots; //name id or -1, size is a power of 2 kept at least twice the amount of names
+
+    NameTable(): slots(1024, -1) {}
+
+    int intern(std::string_view name, uint64_t hash) {
+        size_t mask = slots.size()-1;
+        for (size_t i = hash & mask;; i = (i+1) & mask) {
+            int id = slots[i];
+            if(id < 0) {
+                slots[i] = names.size();
+                names.push_back(name);
+                hashes.push_back(hash);
+                if(names.size() * 2 > slots.size()) grow();
+                return names.size()-1;
+            }
+            if(hashes[id] == hash && names[id] == name) return id;
+        }
+    }
+
+    int intern(std::string_view name) {
+        return intern(name, netlist_name_hash(name));
+    }
+
+    void grow() {
+        slots.assign(slots.size() * 2, -1);
+        size_t mask = slots.size()-1;
+        for (int id = 0; id < (int) names.size(); ++id) {
+            size_t i = hashes[id] & mask;
+            while(slots[i] >= 0) i = (i+1) & mask;
+            slots[i] = id;
+        }
+    }
+};
+
+// Statements and names of a chunk of the file, names being ids of the chunk until they are made global.
+struct NetlistChunk {
+    const char *begin, *end;
+    std::vector<NetlistStatement> statements;
+    std::vector<int> inputs;
+    NameTable names;
+    std::string error;
+
+    int intern(std::string_view name) {
+        return names.intern(name);
+    }
+};
+
+bool netlist_name_char(char c) {
+    return c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != '=' && c != '(' && c != ')' && c != ',';
+}
+
+//Splits a line into its names, BLIF continuation lines ("\" at the end) being joined
+void netlist_tokens(const char *&p, const char *end, std::vector<std::string_view> &tokens) {
+    tokens.clear();
+    while(p < end) {
+        char c = *p;
+        if(c == '\n') {
+            ++p;
+            break;
+        }
+        if(c == '#') {
+            while(p < end && *p != '\n') ++p;
+            continue;
+        }
+        if(c == '\\' && (p+1 == end || p[1] == '\n' || p[1] == '\r')) {
+            ++p;
+            while(p < end && *p != '\n') ++p;
+            if(p < end) ++p;
+            continue;
+        }
+        if(!netlist_name_char(c)) {
+            ++p;
+            continue;
+        }
+        const char *token = p;
+        while(p < end && netlist_name_char(*p) && !(*p == '\\' && (p+1 == end || p[1] == '\n' || p[1] == '\r'))) ++p;
+        tokens.push_back(std::string_view(token, p - token));
+    }
+}
+
+std::string netlist_upper(std::string_view name) {
+    std::string upper(name);
+    for (char &c: upper) {
+        if(c >= 'a' && c <= 'z') c += 'A' - 'a';
+    }
+    return upper;
+}
+
+//First pass: tokenizes a chunk and interns its names locally
+void parse_netlist_chunk(NetlistChunk &chunk, NetlistFormat format) {
+    std::vector<std::string_view> tokens;
+    const char *p = chunk.begin;
+    int register_type = chunk.intern("DFF");
+    int names_type = chunk.intern("NAMES");
+
+    auto add = [&](NetlistStatementKind kind, int type, std::string_view output, int first_input, int last_input) {
+        NetlistStatement statement = {kind, type, chunk.intern(output), (int) chunk.inputs.size(), 0};
+        for (int i = first_input; i < last_input; ++i) {
+            chunk.inputs.push_back(chunk.intern(tokens[i]));
+        }
+        statement.input_end = chunk.inputs.size();
+        chunk.statements.push_back(statement);
+    };
+
+    while(p < chunk.end && chunk.error.empty()) {
+        netlist_tokens(p, chunk.end, tokens);
+        if(tokens.empty()) continue;
+
+        if(format == BENCH) {
+            //INPUT(a) | OUTPUT(a) | a = TYPE(b, c, ...)
+            std::string keyword = netlist_upper(tokens[0]);
+            if(tokens.size() == 2 && keyword == "INPUT") {
+                add(NETLIST_INPUT, -1, tokens[1], 0, 0);
+            } else if(tokens.size() == 2 && keyword == "OUTPUT") {
+                add(NETLIST_OUTPUT, -1, tokens[1], 0, 0);
+            } else if(tokens.size() >= 2) {
+                std::string type = netlist_upper(tokens[1]);
+                if(type == "DFF") {
+                    if(tokens.size() != 3) chunk.error = "DFF with " + std::to_string(tokens.size()-2) + " inputs: " + std::string(tokens[0]);
+                    else add(NETLIST_REGISTER, register_type, tokens[0], 2, 3);
+                } else {
+                    add(NETLIST_GATE, chunk.intern(tokens[1]), tokens[0], 2, tokens.size());
+                }
+            } else {
+                chunk.error = "Unknown statement: " + std::string(tokens[0]);
+            }
+        } else {
+            //.inputs a b ... | .outputs a b ... | .names a b ... out | .latch in out [type control] [init]
+            std::string_view keyword = tokens[0];
+            if(keyword == ".inputs") {
+                for (int i = 1; i < (int) tokens.size(); ++i) {
+                    add(NETLIST_INPUT, -1, tokens[i], 0, 0);
+                }
+            } else if(keyword == ".outputs") {
+                for (int i = 1; i < (int) tokens.size(); ++i) {
+                    add(NETLIST_OUTPUT, -1, tokens[i], 0, 0);
+                }
+            } else if(keyword == ".names") {
+                if(tokens.size() < 2) chunk.error = ".names without output";
+                else add(NETLIST_GATE, names_type, tokens[tokens.size()-1], 1, tokens.size()-1);
+            } else if(keyword == ".latch") {
+                if(tokens.size() < 3) chunk.error = ".latch without output";
+                else add(NETLIST_REGISTER, register_type, tokens[2], 1, 2);
+            } else if(keyword == ".model" || keyword == ".end" || keyword == ".clock" || keyword == ".default_input_arrival") {
+                //nothing to retime
+            } else if(keyword[0] == '.') {
+                chunk.error = "Unsupported BLIF construct: " + std::string(keyword);
+            }
+            //anything else is a cover line of the last .names
+        }
+    }
+}
+
+/**
+ * NETLIST IMPORTER
+ * Imports an ISCAS89 .bench netlist or a BLIF netlist (.inputs, .outputs, .names and .latch) into a Graph:
+ * - Every gate is a vertex with the delay of its type (options.gate_delays, options.default_delay).
+ * - Flip-flops (DFF, .latch) are not vertices, they are the registers of the edges leaving the gate that drives them.
+ * - Vertex 0 (host) drives the primary inputs and vertex 1 (sink) takes the primary outputs, both with delay 0,
+ *   with an edge sink -> host of options.host_registers registers (a 0 weight cycle if 0 and there are
+ *   combinational paths from inputs to outputs).
+ * The file is mapped and split into options.thread_count chunks at line boundaries, tokenized in parallel with
+ * the names interned per chunk, then the chunk names are merged into global ids in chunk order, and every
+ * chunk translates its statements in parallel. So the result does not depend on the amount of threads.
+ * Returns a NetlistResult with the graph (vertices and edges must be freed) and the name of each vertex.
+ */
+NetlistResult import_netlist(std::string path, NetlistFormat format, NetlistOptions &options) {
+    NetlistResult result;
+    result.r = false;
+    result.graph = Graph(nullptr, nullptr, 0, 0);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        result.error = "Could not open " + path;
+        return result;
+    }
+    struct stat file_stat;
+    fstat(fd, &file_stat);
+    size_t size = file_stat.st_size;
+    void *map = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if(map == MAP_FAILED) {
+        result.error = "Could not map " + path;
+        return result;
+    }
+    const char *text = (const char *) map;
+    const char *text_end = text + size;
+
+    //chunks end at a line break that is not a continuation
+    int thread_count = std::max(1, options.thread_count);
+    std::vector<NetlistChunk> chunks(thread_count);
+    const char *chunk_begin = text;
+    for (int t = 0; t < thread_count; ++t) {
+        const char *chunk_end = t == thread_count-1 ? text_end : std::max(chunk_begin, text + size / thread_count * (t+1));
+        while(chunk_end < text_end) {
+            if(*chunk_end == '\n') {
+                const char *last = chunk_end;
+                while(last > text && (last[-1] == '\r')) --last;
+                if(last == text || last[-1] != '\\') {
+                    ++chunk_end;
+                    break;
+                }
+            }
+            ++chunk_end;
+        }
+        chunks[t].begin = chunk_begin;
+        chunks[t].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    auto run_parallel = [&](std::function<void(int)> work) {
+        std::vector<std::thread> threads;
+        for (int t = 1; t < thread_count; ++t) {
+            threads.push_back(std::thread(work, t));
+        }
+        work(0);
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+    };
+
+    //first pass: tokenize and intern per chunk
+    run_parallel([&](int t) {
+        parse_netlist_chunk(chunks[t], format);
+    });
+
+    //merge names in chunk order, reusing the hashes of the first pass
+    NameTable names;
+    std::vector<std::vector<int>> global_ids(thread_count);
+    for (int t = 0; t < thread_count; ++t) {
+        if(!chunks[t].error.empty() && result.error.empty()) result.error = chunks[t].error;
+        NameTable &chunk_names = chunks[t].names;
+        for (int id = 0; id < (int) chunk_names.names.size(); ++id) {
+            global_ids[t].push_back(names.intern(chunk_names.names[id], chunk_names.hashes[id]));
+        }
+        chunk_names = NameTable();
+    }
+    std::vector<std::string_view> &name_list = names.names;
+
+    //second pass: statements to global ids
+    run_parallel([&](int t) {
+        for (NetlistStatement &statement: chunks[t].statements) {
+            if(statement.type >= 0) statement.type = global_ids[t][statement.type];
+            statement.output = global_ids[t][statement.output];
+        }
+        for (int &input: chunks[t].inputs) {
+            input = global_ids[t][input];
+        }
+    });
+
+    //gate type delays, gate types being case insensitive
+    std::vector<int> type_delay(name_list.size(), -1);
+    auto delay = [&](int type) {
+        if(type_delay[type] < 0) {
+            auto it = options.gate_delays.find(netlist_upper(name_list[type]));
+            type_delay[type] = it != options.gate_delays.end() ? it->second : options.default_delay;
+        }
+        return type_delay[type];
+    };
+
+    //driver of each signal: vertex of its gate, or register statement
+    const int HOST = 0, SINK = 1;
+    std::vector<int> driver_vertex(name_list.size(), -1);
+    std::vector<int> register_input(name_list.size(), -1); //signal in front of the register driving each signal
+    std::vector<Vertex> vertices = { Vertex(0), Vertex(0) };
+    result.vertex_names = { "host", "sink" };
+    for (int t = 0; t < thread_count && result.error.empty(); ++t) {
+        for (NetlistStatement &statement: chunks[t].statements) {
+            if(statement.kind == NETLIST_OUTPUT) continue;
+            if(driver_vertex[statement.output] >= 0 || register_input[statement.output] >= 0) {
+                result.error = "Signal driven twice: " + std::string(name_list[statement.output]);
+                break;
+            }
+            if(statement.kind == NETLIST_INPUT) {
+                driver_vertex[statement.output] = HOST;
+            } else if(statement.kind == NETLIST_REGISTER) {
+                register_input[statement.output] = chunks[t].inputs[statement.input_begin];
+            } else {
+                driver_vertex[statement.output] = vertices.size();
+                vertices.push_back(Vertex(delay(statement.type)));
+                result.vertex_names.push_back(std::string(name_list[statement.output]));
+            }
+        }
+    }
+
+    //gate and registers in front of each signal, following chains of registers
+    std::vector<int> signal_vertex(name_list.size(), -1);
+    std::vector<int> signal_registers(name_list.size(), 0);
+    std::vector<int> chain;
+    auto resolve = [&](int signal) {
+        chain.clear();
+        while(signal_vertex[signal] < 0 && driver_vertex[signal] < 0) {
+            if(register_input[signal] < 0 || (int) chain.size() > (int) name_list.size()) return false;
+            chain.push_back(signal);
+            signal = register_input[signal];
+        }
+        if(signal_vertex[signal] < 0) signal_vertex[signal] = driver_vertex[signal];
+        for (int i = chain.size()-1; i >= 0; --i) {
+            signal_vertex[chain[i]] = signal_vertex[signal];
+            signal_registers[chain[i]] = signal_registers[signal] + 1;
+            signal = chain[i];
+        }
+        return true;
+    };
+
+    std::vector<Edge> edges;
+    for (int t = 0; t < thread_count && result.error.empty(); ++t) {
+        for (NetlistStatement &statement: chunks[t].statements) {
+            if(statement.kind != NETLIST_GATE && statement.kind != NETLIST_OUTPUT) continue;
+
+            //a gate is fed by its inputs, the sink by the output signal itself
+            int to = statement.kind == NETLIST_GATE ? driver_vertex[statement.output] : SINK;
+            const int *signals = statement.kind == NETLIST_GATE ? chunks[t].inputs.data() + statement.input_begin : &statement.output;
+            int signal_count = statement.kind == NETLIST_GATE ? statement.input_end - statement.input_begin : 1;
+            for (int i = 0; i < signal_count; ++i) {
+                int signal = signals[i];
+                if(!resolve(signal)) {
+                    result.error = "Undriven signal or register loop: " + std::string(name_list[signal]);
+                    break;
+                }
+                edges.push_back(Edge(signal_vertex[signal], to, signal_registers[signal]));
+            }
+            if(!result.error.empty()) break;
+        }
+    }
+    edges.push_back(Edge(SINK, HOST, options.host_registers));
+
+    if(map) munmap(map, size);
+
+    if(!result.error.empty()) {
+        result.vertex_names.clear();
+        return result;
+    }
+
+    Vertex *graph_vertices = (Vertex *) malloc(sizeof(Vertex) * vertices.size());
+    for (int i = 0; i < (int) vertices.size(); ++i) {
+        graph_vertices[i] = vertices[i];
+    }
+    Edge *graph_edges = (Edge *) malloc(sizeof(Edge) * edges.size());
+    for (int i = 0; i < (int) edges.size(); ++i) {
+        graph_edges[i] = edges[i];
+    }
+
+#ifdef NETLISTDEBUG
+    printf("Imported %s: %d names, %d vertices, %d edges\n", path.c_str(), (int) name_list.size(), (int) vertices.size(), (int) edges.size());
+#endif
+
+    result.r = true;
+    result.graph = Graph(graph_vertices, graph_edges, vertices.size(), edges.size());
+    return result;
+}
+
+NetlistResult import_bench(std::string path, NetlistOptions &options) {
+    return import_netlist(path, BENCH, options);
+}
+
+NetlistResult import_blif(std::string path, NetlistOptions &options) {
+    return import_netlist(path, BLIF, options);
+}
+
+#endif
@@ -4,20 +4,34 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/bellman_ford_shortest_paths.hpp>
 #include <set>
+#include <queue>
+#include <algorithm>
 
 #include "types.h"
 #include "wd.cpp" 
 #include "feas.cpp" 
 #include "graph_printer.cpp" 
+#include "cycle_ratio.cpp"
+#include "parallel_bellman.cpp"
+#include "trace.cpp"
+#include "instrument.cpp"
 
-//#define OPT1DEBUG
-//#define OPT2DEBUG
+//#define OPTDEBUG //debug mains, the binary search itself is traced with TraceInstrument (see trace.cpp)
 
-#if defined(OPT1DEBUG) || defined(OPT2DEBUG) 
+#ifdef OPTDEBUG
 #include <iomanip>
 #include <iostream>
 #endif
 
+//Counts the relaxations of the Bellman-Ford of OPT1
+template<typename Instrument>
+struct TraceBellmanVisitor: boost::default_bellman_visitor {
+    template<typename BGLEdge, typename BGLGraph>
+    void edge_relaxed(BGLEdge, const BGLGraph &) {
+        Instrument::count(TRACE_BELLMAN_RELAXATIONS, 1);
+    }
+};
+
 /**
  * Bellman ALGORITHM
  * Internally builds a bgl graph from the provided vertices and edges.
@@ -25,10 +39,9 @@
  * Result is stored into the distance array, which is required to be of size vertex_count+1.
  * Returns true if no negative cycle was found.
  */
+template<typename Instrument = NoInstrument>
 bool bellman(Graph &graph, int *distance) {
-#ifdef SPACEBENCH
-    space_bench->push_stack();
-#endif
+    Instrument::enter("bellman");
     using namespace boost;
     typedef adjacency_list <vecS, vecS, directedS, no_property, property<edge_weight_t, int>> BGLGraph;
 
@@ -41,10 +54,8 @@ bool bellman(Graph &graph, int *distance) {
         add_edge(edges[i].from, edges[i].to, edges[i].weight, g);
     }
 
-#ifdef SPACEBENCH
-    space_bench->allocated(sizeof(int) * graph.vertex_count, false, BGLVERTEX, "BGL graph vertices");
-    space_bench->allocated(sizeof(int) * 2 * graph.edge_count, false, BGLEDGE, "BGL graph edges");
-#endif
+    Instrument::allocated(sizeof(int) * graph.vertex_count, false, BGLVERTEX, "BGL graph vertices");
+    Instrument::allocated(sizeof(int) * 2 * graph.edge_count, false, BGLEDGE, "BGL graph edges");
 
     // Add a new vertex (root) with an edge to each other vertex to guarantee reachability
     for(int i = 0; i < vertex_count; ++i) {
@@ -53,11 +64,9 @@ bool bellman(Graph &graph, int *distance) {
 
     distance[vertex_count] = 0;
 
-    bool r = bellman_ford_shortest_paths(g, distance_map(distance).root_vertex(vertex_count));
+    bool r = bellman_ford_shortest_paths(g, distance_map(distance).root_vertex(vertex_count).visitor(TraceBellmanVisitor<Instrument>()));
 
-#ifdef SPACEBENCH
-    space_bench->pop_stack();
-#endif
+    Instrument::leave();
 
     return r;
 }
@@ -68,71 +77,94 @@ struct OptResult {
     Graph graph; //retimed graph
 };
 
+/**
+ * Gets the different c values from D(u,v), the only candidates for the minimized clock period (see wd_c_candidates).
+ * lower_bound: candidates below it are discarded (see period_lower_bound).
+ * c_count: set to the amount of candidates.
+ * Returns an array of c_count candidates in increasing order.
+ */
+template<typename Instrument = NoInstrument>
+int *get_c_candidates(Graph &graph, WDEntry *WD, int *c_count, int lower_bound = 0) {
+    Instrument::enter("get_c_candidates");
+    std::vector<int> candidates = wd_c_candidates<Instrument>(WD, (long long) graph.vertex_count * graph.vertex_count, lower_bound);
+
+    *c_count = candidates.size();
+    int *c_candidates = (int *) malloc(sizeof(int) * *c_count);
+    std::copy(candidates.begin(), candidates.end(), c_candidates);
+    Instrument::allocated(sizeof(int) * *c_count, true, INT, "c candidates array");
+    Instrument::leave();
+    return c_candidates;
+}
+
+/**
+ * Appends the edges for the 7.1 constraints to opt_edges: an edge v -> u with weight w(e) for each edge e = u -> v.
+ * They are the same for every c.
+ */
+void add_7_1_edges(Graph &graph, std::vector<Edge> &opt_edges) {
+    Edge *edges = graph.edges;
+    for (int i = 0; i < graph.edge_count; ++i) {
+        opt_edges.push_back(Edge(edges[i].to, edges[i].from, edges[i].weight));
+    }
+}
+
+/**
+ * Appends the edges for the 7.2 constraints of the target c to opt_edges: an edge v -> u with weight W(u, v) - 1 for each D(u, v) > c.
+ * Pairs with D(u, v) - d(u) > c or D(u, v) - d(v) > c are skipped, their constraint is implied by the one of a shorter pair.
+ */
+template<typename Instrument = NoInstrument>
+void add_7_2_edges(Graph &graph, WDEntry *WD, int c, std::vector<Edge> &opt_edges) {
+    Instrument::enter("7.2 edges");
+    size_t edge_count = opt_edges.size();
+    Vertex *vertices = graph.vertices;
+    int vertex_count = graph.vertex_count;
+    for (int u = 0; u < vertex_count; ++u) {
+        for (int v = 0; v < vertex_count; ++v) {
+            WDEntry entry = WD[u * vertex_count + v];
+            //check the requirements on D(u,v)
+            if(entry.D > c && (entry.D - vertices[u].weight <= c) && (entry.D - vertices[v].weight <= c)) {
+                //add the edge v -> u with weight W(u, v) - 1
+                opt_edges.push_back(Edge(v, u, entry.W - 1));
+            }
+        }
+    }
+    Instrument::count(TRACE_CONSTRAINT_EDGES, opt_edges.size() - edge_count);
+    Instrument::leave();
+}
+
 /**
  * OPT1 ALGORITHM
  * Uses Bellman.
+ * Candidates below the maximum cycle ratio bound are not probed.
+ * thread_count: above 1, the constraints are solved by bellman_parallel with that many threads.
  * Returns an OptResult.
  */
-OptResult opt1(Graph &graph, WDEntry *WD) {
-#ifdef SPACEBENCH
-    space_bench->push_stack();
-#endif
+template<typename Instrument = NoInstrument>
+OptResult opt1(Graph &graph, WDEntry *WD, int thread_count = 1) {
+    Instrument::enter("opt1");
 
     int vertex_count = graph.vertex_count;
     int edge_count = graph.edge_count;
     Edge *edges = graph.edges;
     Vertex *vertices = graph.vertices;
 
-    WDEntry entry;
-
-    //Get different c values from D(u,v)
-    int* c_candidates;
+    //Get different c values from D(u,v), no retiming can go below the maximum cycle ratio
     int c_count;
-    {
-#ifdef SPACEBENCH
-        space_bench->push_stack();
-#endif
-        std::set<int> c_candidates_set;
-        for (int u = 0; u < vertex_count; ++u) {
-            for (int v = 0; v < vertex_count; ++v) {
-                entry = WD[u * vertex_count + v];
-                if(entry.D > 0 && entry.D < MAXINT) {
-                    c_candidates_set.insert(entry.D);
-                }
-            }
-        }
-        c_count = c_candidates_set.size();
-        c_candidates = (int *) malloc(sizeof(int) * c_count);
-        int k = 0;
-        for (int c: c_candidates_set) {
-            c_candidates[k] = c;
-            ++k;
-        }
-#ifdef SPACEBENCH
-        space_bench->allocated(sizeof(int) * c_count, false, INT, "c candidates set");
-        space_bench->allocated(sizeof(int) * c_count, true, INT, "c candidates array");
-        space_bench->pop_stack();
-#endif
-    }
+    int *c_candidates = get_c_candidates<Instrument>(graph, WD, &c_count, period_lower_bound<Instrument>(graph));
 
     //Edges to send to bellman (7.1 and 7.2)
     std::vector<Edge> opt_edges;
 
     //Get edges for 7.1 (the same for every c)
-    for (int i = 0; i < edge_count; ++i) {
-        opt_edges.push_back(Edge(edges[i].to, edges[i].from, edges[i].weight));
-    }
+    add_7_1_edges(graph, opt_edges);
 
     int c = -1; //best c
     int *distance = (int *) malloc(sizeof(int) * (vertex_count+1));;//distance array of best c
     int *tmp_distance = (int *) malloc(sizeof(int) * (vertex_count+1));//distance array of current c
     int *aux_distance;//aux for swapping between distance and temp_distance
 
-#ifdef SPACEBENCH
-        space_bench->allocated(sizeof(Edge) * edge_count, false, EDGE, "opt edges for 7.1");
-        space_bench->allocated(sizeof(int) * (vertex_count+1), true, INT, "distance array");
-        space_bench->allocated(sizeof(int) * (vertex_count+1), true, INT, "tmp distance array");
-#endif
+    Instrument::allocated(sizeof(Edge) * edge_count, false, EDGE, "opt edges for 7.1");
+    Instrument::allocated(sizeof(int) * (vertex_count+1), true, INT, "distance array");
+    Instrument::allocated(sizeof(int) * (vertex_count+1), true, INT, "tmp distance array");
 
     //Binary search ordered c values
     int b, current_c;
@@ -143,39 +175,19 @@ OptResult opt1(Graph &graph, WDEntry *WD) {
         if(top <= bot) loop = false;
         b = (top + bot)/2;
         current_c = c_candidates[b];
-
-#ifdef OPT1DEBUG
-        printf("[Binary search] b: %d\tbot: %d\ttop: %d\tcc = %d\n", b, bot, top, current_c);
-#endif
+        Instrument::probe_start();
 
         //Get edges for 7.2
-        for (int u = 0; u < vertex_count; ++u) {
-            for (int v = 0; v < vertex_count; ++v) {
-                entry = WD[u * vertex_count + v];
-                //check the requirements on D(u,v)
-                if(entry.D > current_c && (entry.D - vertices[u].weight <= current_c) && (entry.D - vertices[v].weight <= current_c)) {
-                    //add the edge v -> u with weight W(u, v) - 1
-                    opt_edges.push_back(Edge(v, u, entry.W - 1));
-                }
-            }
-        }
-
-#ifdef SPACEBENCH
-        space_bench->push_stack();
-        space_bench->allocated(sizeof(Edge) * (opt_edges.size() - edge_count), false, EDGE, "opt edges for 7.2");
-#endif
+        add_7_2_edges<Instrument>(graph, WD, current_c, opt_edges);
 
-#ifdef OPT1DEBUG
-        printf("--- OPT EDGES --- \n");
-        for (int i = 0; i < opt_edges.size(); ++i) {
-            printf("(%d, %d, [%d]) \n", opt_edges[i].from, opt_edges[i].to, opt_edges[i].weight);
-        }
-#endif
+        Instrument::enter("opt1 probe");
+        Instrument::allocated(sizeof(Edge) * (opt_edges.size() - edge_count), false, EDGE, "opt edges for 7.2");
 
         Graph opt_graph(vertices, &opt_edges[0], vertex_count, opt_edges.size());
 
         //Run bellman
-        bool r = bellman(opt_graph, tmp_distance); 
+        bool r = thread_count > 1 ? bellman_parallel<Instrument>(opt_graph, tmp_distance, thread_count) : bellman<Instrument>(opt_graph, tmp_distance);
+        Instrument::probe("opt1", b, bot, top, current_c, r, current_c);
 
         //Remove edges for 7.2
         opt_edges.erase(opt_edges.begin() + edge_count, opt_edges.end());
@@ -190,19 +202,11 @@ OptResult opt1(Graph &graph, WDEntry *WD) {
             aux_distance = distance;
             distance = tmp_distance;
             tmp_distance = aux_distance;
-#ifdef OPT1DEBUG
-            std::cout << "Retiming found" << std::endl; 
-#endif
         } else {
             bot = b + 1;
-#ifdef OPT1DEBUG
-            std::cout << "Negative cycle" << std::endl;
-#endif
         }
 
-#ifdef SPACEBENCH
-        space_bench->pop_stack();
-#endif
+        Instrument::leave();
     }
 
     //If no retiming was found, return base graph as best retiming.
@@ -225,10 +229,8 @@ OptResult opt1(Graph &graph, WDEntry *WD) {
             retimed_vertices[i] = Vertex(distance[i]);
         }
 
-#ifdef SPACEBENCH
-        space_bench->allocated(sizeof(Vertex) * vertex_count, true, VERTEX, "retimed vertices");
-        space_bench->allocated(sizeof(Edge) * edge_count, true, EDGE, "retimed edges");
-#endif
+        Instrument::allocated(sizeof(Vertex) * vertex_count, true, VERTEX, "retimed vertices");
+        Instrument::allocated(sizeof(Edge) * edge_count, true, EDGE, "retimed edges");
 
         Graph retimed(retimed_vertices, retimed_edges, vertex_count, edge_count);
         result = {true, c, retimed};
@@ -238,67 +240,219 @@ OptResult opt1(Graph &graph, WDEntry *WD) {
     free(tmp_distance);
     free(distance);
 
-#ifdef SPACEBENCH
-        space_bench->deallocated(sizeof(int) * c_count, INT, "c candidates array");
-        space_bench->deallocated(sizeof(int) * (vertex_count+1), INT, "distance array");
-        space_bench->deallocated(sizeof(int) * (vertex_count+1), INT, "tmp distance array");
-        space_bench->pop_stack();
-#endif
+    Instrument::deallocated(sizeof(int) * c_count, INT, "c candidates array");
+    Instrument::deallocated(sizeof(int) * (vertex_count+1), INT, "distance array");
+    Instrument::deallocated(sizeof(int) * (vertex_count+1), INT, "tmp distance array");
+    Instrument::leave();
 
     return result;
 }
 
 /**
- * OPT2 ALGORITHM
- * Uses feas.
+ * Adds the difference constraint x -> y with weight b (r(y) - r(x) <= b) to a feasible system, keeping distance a
+ * solution of it (incremental negative cycle detection, Ramalingam-Reps style).
+ * If the arc is violated, the vertices reached from y are decreased by the amount they need in decreasing order of
+ * that amount, a Dijkstra over the reduced weights b + distance(p) - distance(q) >= 0, so each vertex moves once.
+ * out: arcs of the system by source (target, weight), the new arc is added to it.
+ * need, stamp, run: scratch of vertex_count size kept across calls, run is increased by one every call.
+ * trail: old distances of the vertices moved are appended to it, to roll them back.
+ * Returns false if the arc closes a negative cycle (distance is then partly moved, see trail).
+ */
+template<typename Instrument = NoInstrument>
+bool add_constraint(std::vector<std::vector<std::pair<int, int>>> &out, int *distance, int x, int y, int b,
+        std::vector<int> &need, std::vector<int> &stamp, int &run, std::vector<std::pair<int, int>> &trail) {
+    out[x].push_back({y, b});
+    if(distance[y] <= distance[x] + b) return true;
+
+    ++run;
+    std::priority_queue<std::pair<int, int>> heap; //(need, vertex), largest need first
+    need[y] = distance[y] - distance[x] - b;
+    stamp[y] = run;
+    heap.push({need[y], y});
+    while(!heap.empty()) {
+        std::pair<int, int> top = heap.top();
+        heap.pop();
+        int q = top.second;
+        if(top.first != need[q] || stamp[q] != run) continue;
+        //x has to go down too: the path from y back to x and the new arc make a negative cycle
+        if(q == x) return false;
+        stamp[q] = -run; //done
+        trail.push_back({q, distance[q]});
+        distance[q] -= top.first;
+        for (std::pair<int, int> &arc: out[q]) {
+            int t = arc.first;
+            if(stamp[t] == -run) continue;
+            int t_need = distance[t] - distance[q] - arc.second;
+            Instrument::count(TRACE_BELLMAN_RELAXATIONS, 1);
+            if(t_need > 0 && (stamp[t] != run || t_need > need[t])) {
+                need[t] = t_need;
+                stamp[t] = run;
+                heap.push({t_need, t});
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * OPT1 ALGORITHM, sweeping the candidates downwards instead of a binary search.
+ * Same inputs and outputs as opt1. The 7.2 constraints only grow as c decreases, so each candidate adds the ones of the
+ * pairs with D(u, v) equal to the candidate above it to the solution of the previous one (see add_constraint), and
+ * the sweep stops at the first infeasible candidate, rolling back its changes.
+ * All candidates above the optimum are visited, but together they cost a single incremental solve: fast when the
+ * optimum is near the top of the candidates, a binary search (opt1) is better when it is near the bottom.
  * Returns an OptResult.
  */
-OptResult opt2(Graph &graph, WDEntry *WD) {
-#ifdef SPACEBENCH
-    space_bench->push_stack();
-#endif
+template<typename Instrument = NoInstrument>
+OptResult opt1_sweep(Graph &graph, WDEntry *WD) {
+    Instrument::enter("opt1_sweep");
+
     int vertex_count = graph.vertex_count;
     int edge_count = graph.edge_count;
     Edge *edges = graph.edges;
     Vertex *vertices = graph.vertices;
 
-    int *deltas = (int *) malloc(sizeof(int) * vertex_count);
-#ifdef SPACEBENCH
-        space_bench->allocated(sizeof(int) * vertex_count, true, INT, "deltas");
-#endif
-
-    WDEntry entry;
-
-    //Get different c values from D(u,v)
-    int* c_candidates;
+    //Get different c values from D(u,v), no retiming can go below the maximum cycle ratio
     int c_count;
-    {
-#ifdef SPACEBENCH
-        space_bench->push_stack();
-#endif
-        std::set<int> c_candidates_set;
-        for (int u = 0; u < vertex_count; ++u) {
-            for (int v = 0; v < vertex_count; ++v) {
-                entry = WD[u * vertex_count + v];
-                if(entry.D > 0 && entry.D < MAXINT) {
-                    c_candidates_set.insert(entry.D);
+    int *c_candidates = get_c_candidates<Instrument>(graph, WD, &c_count, period_lower_bound<Instrument>(graph));
+
+    //Pairs by the candidate at which their 7.2 constraint is added, the one below their D(u, v): counting sort.
+    //Pairs implied by a shorter one at that candidate are skipped, they stay implied below it.
+    std::vector<int> bucket_offsets(c_count+1, 0);
+    std::vector<int> pairs;
+    if(c_count > 0) {
+        Instrument::enter("7.2 pairs");
+        //candidate below each D, by a table when the D values are in a small range (as in get_c_candidates)
+        int min_c = c_candidates[0];
+        int max_c = c_candidates[c_count-1];
+        std::vector<int> below;
+        if((long long) max_c - min_c < 4LL * vertex_count * vertex_count + 1024) {
+            below.resize(max_c - min_c + 1);
+            for (int k = 1; k < c_count; ++k) {
+                std::fill(below.begin() + c_candidates[k-1] - min_c + 1, below.begin() + c_candidates[k] - min_c + 1, k-1);
+            }
+        }
+        for (int pass = 0; pass < 2; ++pass) {
+            std::vector<int> position(bucket_offsets.begin(), bucket_offsets.end()-1);
+            for (int u = 0; u < vertex_count; ++u) {
+                for (int v = 0; v < vertex_count; ++v) {
+                    int D = WD[u * vertex_count + v].D;
+                    if(D <= min_c || D > max_c) continue;
+                    int k = below.empty() ? std::lower_bound(c_candidates, c_candidates + c_count, D) - c_candidates - 1 : below[D - min_c];
+                    if(D - vertices[u].weight > c_candidates[k] || D - vertices[v].weight > c_candidates[k]) continue;
+                    if(pass == 0) ++bucket_offsets[k+1];
+                    else pairs[position[k]++] = u * vertex_count + v;
+                }
+            }
+            if(pass == 0) {
+                for (int k = 0; k < c_count; ++k) {
+                    bucket_offsets[k+1] += bucket_offsets[k];
                 }
+                pairs.resize(bucket_offsets[c_count]);
             }
         }
-        c_count = c_candidates_set.size();
-        c_candidates = (int *) malloc(sizeof(int) * c_count);
-        int k = 0;
-        for (int c: c_candidates_set) {
-            c_candidates[k] = c;
-            ++k;
+        Instrument::leave();
+    }
+
+    //7.1: r(u) - r(v) <= w(e), satisfied by r = 0
+    std::vector<std::vector<std::pair<int, int>>> out(vertex_count);
+    for (int i = 0; i < edge_count; ++i) {
+        out[edges[i].to].push_back({edges[i].from, edges[i].weight});
+    }
+    int *distance = (int *) malloc(sizeof(int) * (vertex_count+1));
+    for (int i = 0; i <= vertex_count; ++i) {
+        distance[i] = 0;
+    }
+    std::vector<int> need(vertex_count), stamp(vertex_count, 0);
+    int run = 0;
+    std::vector<std::pair<int, int>> trail;
+
+    Instrument::allocated(sizeof(int) * pairs.size(), false, INT, "7.2 pairs by candidate");
+    Instrument::allocated(sizeof(Edge) * edge_count, false, EDGE, "opt edges for 7.1");
+    Instrument::allocated(sizeof(int) * (vertex_count+1), true, INT, "distance array");
+
+    //The highest candidate has no 7.2 constraint, r = 0 is a solution
+    int c = c_count > 0 ? c_candidates[c_count-1] : -1;
+    for (int k = c_count-2; k >= 0; --k) {
+        Instrument::probe_start();
+        Instrument::enter("opt1_sweep step");
+        trail.clear();
+        bool r = true;
+        for (int i = bucket_offsets[k]; i < bucket_offsets[k+1] && r; ++i) {
+            int u = pairs[i] / vertex_count;
+            int v = pairs[i] % vertex_count;
+            //the edge v -> u with weight W(u, v) - 1
+            r = add_constraint<Instrument>(out, distance, v, u, WD[pairs[i]].W - 1, need, stamp, run, trail);
+            Instrument::count(TRACE_CONSTRAINT_EDGES, 1);
         }
-#ifdef SPACEBENCH
-        space_bench->allocated(sizeof(int) * c_count, false, INT, "c candidates set");
-        space_bench->allocated(sizeof(int) * c_count, true, INT, "c candidates array");
-        space_bench->pop_stack();
-#endif
+        Instrument::allocated(sizeof(Edge) * (bucket_offsets[k+1] - bucket_offsets[k]), false, EDGE, "opt edges for 7.2");
+        Instrument::leave();
+        Instrument::probe("opt1_sweep", k, 0, c_count-1, c_candidates[k], r, c_candidates[k]);
+
+        if(!r) {
+            //back to the solution of the candidate above
+            for (int i = trail.size()-1; i >= 0; --i) {
+                distance[trail[i].first] = trail[i].second;
+            }
+            break;
+        }
+        c = c_candidates[k];
+    }
+
+    OptResult result = {false, c, graph};
+    if(c >= 0) {
+        //Calculate edge weights of the retimed graph: wr(e) = w(e) + r(v) - r(u)
+        Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+        for (int i = 0; i < edge_count; ++i) {
+            int from = edges[i].from;
+            int to = edges[i].to;
+            retimed_edges[i] = Edge(from, to, edges[i].weight + distance[to] - distance[from]);
+        }
+
+        //r(Vi) for each vertex is its distance
+        Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+        for (int i = 0; i < vertex_count; ++i) {
+            retimed_vertices[i] = Vertex(distance[i]);
+        }
+
+        Instrument::allocated(sizeof(Vertex) * vertex_count, true, VERTEX, "retimed vertices");
+        Instrument::allocated(sizeof(Edge) * edge_count, true, EDGE, "retimed edges");
+
+        Graph retimed(retimed_vertices, retimed_edges, vertex_count, edge_count);
+        result = {true, c, retimed};
     }
 
+    free(c_candidates);
+    free(distance);
+
+    Instrument::deallocated(sizeof(int) * c_count, INT, "c candidates array");
+    Instrument::deallocated(sizeof(int) * (vertex_count+1), INT, "distance array");
+    Instrument::leave();
+
+    return result;
+}
+
+/**
+ * OPT2 ALGORITHM
+ * Uses feas.
+ * Candidates below the maximum cycle ratio bound are not probed.
+ * Returns an OptResult.
+ */
+template<typename Instrument = NoInstrument>
+OptResult opt2(Graph &graph, WDEntry *WD) {
+    Instrument::enter("opt2");
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+    Vertex *vertices = graph.vertices;
+
+    int *deltas = (int *) malloc(sizeof(int) * vertex_count);
+    Instrument::allocated(sizeof(int) * vertex_count, true, INT, "deltas");
+
+    //Get different c values from D(u,v), no retiming can go below the maximum cycle ratio
+    int c_count;
+    int *c_candidates = get_c_candidates<Instrument>(graph, WD, &c_count, period_lower_bound<Instrument>(graph));
+
     Graph retimed_graph;
     int c = -1; //best c
 
@@ -311,13 +465,11 @@ OptResult opt2(Graph &graph, WDEntry *WD) {
         if(top <= bot) loop = false;
         b = (top + bot)/2;
         current_c = c_candidates[b];
-
-#ifdef OPT2DEBUG
-        printf("[Binary search] b: %d\tbot: %d\ttop: %d\tcc = %d\n", b, bot, top, current_c);
-#endif
+        Instrument::probe_start();
 
         //Run feas
-        FeasResult feas_result = feas(graph, current_c, deltas);
+        FeasResult feas_result = feas<Instrument>(graph, current_c, deltas);
+        Instrument::probe("opt2", b, bot, top, current_c, feas_result.r, feas_result.c);
 
         if(feas_result.r) { 
             //the feas result c may be lesser than the targeted, so continue the binary search from that c.
@@ -339,40 +491,27 @@ OptResult opt2(Graph &graph, WDEntry *WD) {
             c = current_c;
 
             retimed_graph = feas_result.graph;
-
-#ifdef OPT2DEBUG
-            std::cout << "Retiming found for c: " << current_c << std::endl; 
-            print_graph(retimed_graph, "retimed");
-#endif
         } else {
             bot = b + 1;
 
             free(feas_result.graph.vertices);
             free(feas_result.graph.edges);
-#ifdef SPACEBENCH
-        space_bench->deallocated(sizeof(Vertex) * feas_result.graph.vertex_count, INT, "feas result vertices");
-        space_bench->deallocated(sizeof(Edge) * feas_result.graph.edge_count, INT, "feas result edges");
-#endif
-
-#ifdef OPT2DEBUG
-            std::cout << "No retiming found for c: " << current_c << std::endl;
-#endif
+            Instrument::deallocated(sizeof(Vertex) * feas_result.graph.vertex_count, INT, "feas result vertices");
+            Instrument::deallocated(sizeof(Edge) * feas_result.graph.edge_count, INT, "feas result edges");
         }
     }
 
     free(deltas);
     free(c_candidates);
-#ifdef SPACEBENCH
-        space_bench->deallocated(sizeof(int) * vertex_count, INT, "deltas");
-        space_bench->deallocated(sizeof(int) * c_count, INT, "c candidates array");
-        space_bench->pop_stack();
-#endif
+    Instrument::deallocated(sizeof(int) * vertex_count, INT, "deltas");
+    Instrument::deallocated(sizeof(int) * c_count, INT, "c candidates array");
+    Instrument::leave();
 
     if(c >= 0) return {true, c, retimed_graph};
     else return {false, c, graph};;
 }
 
-#if defined(OPT1DEBUG) || defined(OPT2DEBUG) 
+#ifdef OPTDEBUG
 int main_opt1() {
     //Correlator1
     const int vertex_count = 8;
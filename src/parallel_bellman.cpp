@@ -0,0 +1,173 @@
+#ifndef PARALLELBELLMAN
+#define PARALLELBELLMAN
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "types.h"
+#include "trace.cpp"
+#include "instrument.cpp"
+
+//#define PARALLELBELLMANDEBUG
+
+#ifdef PARALLELBELLMANDEBUG
+#include <iostream>
+#endif
+
+//Barrier of a fixed number of threads, reused every round
+struct RoundBarrier {
+    std::mutex mutex;
+    std::condition_variable released;
+    int thread_count;
+    int waiting;
+    long long generation;
+
+    RoundBarrier(int thread_count): thread_count(thread_count), waiting(0), generation(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        long long current = generation;
+        if(++waiting == thread_count) {
+            waiting = 0;
+            ++generation;
+            released.notify_all();
+        } else {
+            released.wait(lock, [&]() { return generation != current; });
+        }
+    }
+};
+
+/**
+ * PARALLEL BELLMAN ALGORITHM
+ * Same contract as bellman: edges are difference constraints, every vertex is reached from a root (vertex_count) with
+ * 0 weight edges, vertex weights are ignored, distance is of size vertex_count+1.
+ * Rounds of Jacobi relaxations: each round computes the new distance of every vertex from the distances of the
+ * previous round only, through its in edges. The vertices are split among the threads in ranges of about the same in
+ * edges, and each thread writes only the distances of its own vertices, so no atomics are needed.
+ * In edges from vertices that did not change in the previous round are skipped.
+ * Round k finds every shortest path of k edges, so without a negative cycle nothing changes by round vertex_count.
+ * The result, and the round that detects a negative cycle, do not depend on the thread count.
+ * thread_count: threads relaxing, the calling thread being one of them.
+ * Returns true if no negative cycle was found.
+ */
+template<typename Instrument = NoInstrument>
+bool bellman_parallel(Graph &graph, int *distance, int thread_count) {
+    Instrument::enter("bellman_parallel");
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+    if(vertex_count == 0) {
+        Instrument::leave();
+        distance[0] = 0;
+        return true;
+    }
+    thread_count = std::max(1, std::min(thread_count, vertex_count));
+
+    //in edges by target
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        ++offsets[edges[i].to+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> sources(edge_count), weights(edge_count);
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int i = 0; i < edge_count; ++i) {
+            int p = position[edges[i].to]++;
+            sources[p] = edges[i].from;
+            weights[p] = edges[i].weight;
+        }
+    }
+
+    //vertex range of each thread, about edge_count / thread_count in edges each
+    std::vector<int> bounds(thread_count+1, vertex_count);
+    bounds[0] = 0;
+    for (int t = 1; t < thread_count; ++t) {
+        long long target = (long long) edge_count * t / thread_count;
+        bounds[t] = std::max(bounds[t-1], (int) (std::lower_bound(offsets.begin(), offsets.end(), target) - offsets.begin()));
+        bounds[t] = std::min(bounds[t], vertex_count);
+    }
+
+    Instrument::allocated(sizeof(int) * (vertex_count+1 + 2 * edge_count), false, INT, "in edges by target");
+    Instrument::allocated(sizeof(int) * 2 * vertex_count + 2 * vertex_count, false, INT, "round distances and changes");
+
+    //distances and changes of the previous round [round & 1] and of the current one [(round + 1) & 1]
+    //every vertex starts at 0, reached from the root, and counts as changed
+    std::vector<int> distances[2] = { std::vector<int>(vertex_count, 0), std::vector<int>(vertex_count, 0) };
+    std::vector<char> changes[2] = { std::vector<char>(vertex_count, 1), std::vector<char>(vertex_count, 0) };
+    //whether each thread changed a distance, by round parity
+    std::vector<char> thread_changed[2] = { std::vector<char>(thread_count, 1), std::vector<char>(thread_count, 0) };
+    std::vector<long long> relaxations(thread_count, 0);
+    RoundBarrier barrier(thread_count);
+    bool converged = false;
+
+    auto relax = [&](int t) {
+        long long relaxed = 0;
+        for (int round = 0; round < vertex_count; ++round) {
+            std::vector<int> &previous = distances[round & 1];
+            std::vector<int> &current = distances[(round + 1) & 1];
+            std::vector<char> &previous_changes = changes[round & 1];
+            std::vector<char> &current_changes = changes[(round + 1) & 1];
+            char changed = 0;
+            for (int v = bounds[t]; v < bounds[t+1]; ++v) {
+                int best = previous[v];
+                for (int i = offsets[v]; i < offsets[v+1]; ++i) {
+                    int u = sources[i];
+                    if(previous_changes[u] && previous[u] + weights[i] < best) best = previous[u] + weights[i];
+                }
+                current[v] = best;
+                current_changes[v] = best < previous[v];
+                if(best < previous[v]) {
+                    changed = 1;
+                    ++relaxed;
+                }
+            }
+            thread_changed[(round + 1) & 1][t] = changed;
+            relaxations[t] = relaxed;
+            barrier.wait();
+
+            //every thread reads the same flags, so they all stop at the same round
+            bool any = false;
+            for (int s = 0; s < thread_count; ++s) {
+                any = any || thread_changed[(round + 1) & 1][s];
+            }
+            if(!any) {
+                if(t == 0) {
+                    converged = true;
+                    std::copy(current.begin(), current.end(), distance);
+                }
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; ++t) {
+        threads.push_back(std::thread(relax, t));
+    }
+    relax(0);
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    distance[vertex_count] = 0;
+    long long total_relaxations = 0;
+    for (long long count: relaxations) {
+        total_relaxations += count;
+    }
+    Instrument::count(TRACE_BELLMAN_RELAXATIONS, total_relaxations);
+
+#ifdef PARALLELBELLMANDEBUG
+    printf("[Parallel bellman] threads: %d\tconverged: %d\trelaxations: %lld\n", thread_count, converged, total_relaxations);
+#endif
+
+    Instrument::leave();
+
+    return converged;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef PERFCOUNTERS
+#define PERFCOUNTERS
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+
+/**
+ * Hardware performance counters of the calling thread (and the threads it creates while they count), read with
+ * perf_event_open: cycles, instructions, L1 data cache read misses, last level cache misses and branch misses.
+ * Only user space is counted, which is allowed with the default perf_event_paranoid of 2.
+ * Every event is opened on its own, so the ones the CPU or the kernel does not have (VMs, containers, seccomp) are
+ * skipped and the rest still count. When none can be opened the counters are simply not available, see
+ * perf_counters_status.
+ * Values are scaled by time enabled / time running when the kernel multiplexes the events.
+ */
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+};
+
+const char *perf_event_names[] = { "cycles", "instructions", "L1D_misses", "LLC_misses", "branch_misses" };
+
+struct PerfCounters {
+    bool opened; //open was tried
+    int fds[PERF_EVENT_COUNT]; //-1 if not available
+    int available;
+    std::string status;
+};
+
+PerfCounters perf_counters;
+
+//Counts of the events since start_perf_counters, -1 for the ones not available
+struct PerfSample {
+    long long values[PERF_EVENT_COUNT];
+};
+
+perf_event_attr perf_event_attribute(PerfEvent event) {
+    perf_event_attr attribute;
+    memset(&attribute, 0, sizeof(attribute));
+    attribute.size = sizeof(attribute);
+    attribute.disabled = 1;
+    attribute.inherit = 1;
+    attribute.exclude_kernel = 1;
+    attribute.exclude_hv = 1;
+    attribute.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch(event) {
+        case PERF_CYCLES:
+            attribute.type = PERF_TYPE_HARDWARE;
+            attribute.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attribute.type = PERF_TYPE_HARDWARE;
+            attribute.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_L1D_MISSES:
+            attribute.type = PERF_TYPE_HW_CACHE;
+            attribute.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_LLC_MISSES:
+            attribute.type = PERF_TYPE_HARDWARE;
+            attribute.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        default:
+            attribute.type = PERF_TYPE_HARDWARE;
+            attribute.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+    return attribute;
+}
+
+/**
+ * Opens the events the first time it is called.
+ * Returns true if at least one of them is available.
+ */
+bool open_perf_counters() {
+    if(perf_counters.opened) return perf_counters.available > 0;
+    perf_counters.opened = true;
+    perf_counters.available = 0;
+
+    std::string missing;
+    int error = 0;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        perf_event_attr attribute = perf_event_attribute((PerfEvent) i);
+        perf_counters.fds[i] = syscall(SYS_perf_event_open, &attribute, 0, -1, -1, 0);
+        if(perf_counters.fds[i] >= 0) {
+            ++perf_counters.available;
+        } else {
+            error = errno;
+            missing += missing.empty() ? perf_event_names[i] : std::string(",") + perf_event_names[i];
+        }
+    }
+
+    if(perf_counters.available == 0) {
+        perf_counters.status = std::string("unavailable (") + strerror(error) + (error == EACCES || error == EPERM ?
+                ", see /proc/sys/kernel/perf_event_paranoid)" : ")");
+    } else if(!missing.empty()) {
+        perf_counters.status = "available, missing " + missing;
+    } else {
+        perf_counters.status = "available";
+    }
+    return perf_counters.available > 0;
+}
+
+//"available", "available, missing <events>" or "unavailable (<reason>)"
+std::string perf_counters_status() {
+    open_perf_counters();
+    return perf_counters.status;
+}
+
+void perf_counters_ioctl(unsigned long request) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if(perf_counters.fds[i] >= 0) ioctl(perf_counters.fds[i], request, 0);
+    }
+}
+
+//Resets the counts and starts counting
+void start_perf_counters() {
+    if(!open_perf_counters()) return;
+    perf_counters_ioctl(PERF_EVENT_IOC_RESET);
+    perf_counters_ioctl(PERF_EVENT_IOC_ENABLE);
+}
+
+void pause_perf_counters() {
+    if(perf_counters.available > 0) perf_counters_ioctl(PERF_EVENT_IOC_DISABLE);
+}
+
+void resume_perf_counters() {
+    if(perf_counters.available > 0) perf_counters_ioctl(PERF_EVENT_IOC_ENABLE);
+}
+
+//Stops counting and returns the counts since start_perf_counters
+PerfSample stop_perf_counters() {
+    PerfSample sample;
+    pause_perf_counters();
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        sample.values[i] = -1;
+        if(!perf_counters.opened || perf_counters.fds[i] < 0) continue;
+        //value, time enabled, time running
+        unsigned long long buffer[3];
+        if(read(perf_counters.fds[i], buffer, sizeof(buffer)) != sizeof(buffer)) continue;
+        if(buffer[2] == 0) {
+            sample.values[i] = 0;
+        } else {
+            sample.values[i] = (long long) ((double) buffer[0] * buffer[1] / buffer[2]);
+        }
+    }
+    return sample;
+}
+
+#endif
@@ -9,72 +9,53 @@
 #include "cp.cpp"
 #include "feas.cpp"
 #include "retiming_checker.cpp"
+#include "multilevel.cpp"
+#include "cycle_ratio.cpp"
+#include "min_area.cpp"
+#include "circuit_families.cpp"
+#include "bench_fixtures.cpp"
+#include "perf_counters.cpp"
+#include "reorder.cpp"
 
-/*
-const int graph_count = 7;
-const int graph_max_index = graph_count-1;
-
-Graph graphs[] = {
-    generate_circuit(100),
-    generate_circuit(200),
-    generate_circuit(300),
-    generate_circuit(400),
-    generate_circuit(500),
-    generate_circuit(600),
-    generate_circuit(700),
-};
-*/
+/**
+ * Graphs come from the seeded fixtures of bench_fixtures.cpp, built or read from the disk cache the first time a benchmark
+ * needs them. Every benchmark computes what else it needs (WD, optimal clock period) before its timed loop.
+ * Counters: vertices, edges, edges/s and vertices/s processed per iteration, and WD_bytes for the benchmarks that use WD.
+ * Hardware counters (perf_counters.cpp) are per iteration, of the timed loop only (they pause with the timer); they are
+ * left out when the kernel does not give access to them, the perf_counters context tells which.
+ */
+void set_graph_counters(benchmark::State& state, Graph &graph, bool uses_wd) {
+    state.counters["vertices"] = graph.vertex_count;
+    state.counters["edges"] = graph.edge_count;
+    state.counters["vertices/s"] = benchmark::Counter(graph.vertex_count, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["edges/s"] = benchmark::Counter(graph.edge_count, benchmark::Counter::kIsIterationInvariantRate);
+    if(uses_wd) {
+        state.counters["WD_bytes"] = benchmark::Counter((double) sizeof(WDEntry) * graph.vertex_count * graph.vertex_count,
+                benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1024);
+    }
+}
 
-const int graph_count = 12;
-const int graph_max_index = graph_count-1;
-
-//Shared array of random graphs
-Graph graphs[] = {
-    generate_circuit(1<<3),
-    generate_circuit(1<<4),
-    generate_circuit(1<<5),
-    generate_circuit(1<<6),
-    generate_circuit(1<<7),
-    generate_circuit(1<<8),
-    generate_circuit(1<<9),
-    generate_circuit(1<<10),
-    generate_circuit(1<<11),
-    generate_circuit(1<<12),
-    generate_circuit(1<<13),
-    generate_circuit(1<<14),
-};
-
-int retimings[graph_count];
-
-const int opt2_wc_graph_count = 7;
-const int opt2_wc_graph_max_index = opt2_wc_graph_count-1;
-
-//Generate a graph for the OPT2 worst case
-Graph generate_opt2_wc_circuit(int vertex_count) {
-    int edge_count = vertex_count;
-    Vertex *vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
-    Edge   *edges    = (Edge *)   malloc(sizeof(Edge) * edge_count);
-
-    vertices[0] = Vertex(vertex_count-1);
-    edges[0]    = Edge(edge_count-1, 0, 1);
-    for (int i = 1; i < vertex_count; ++i) {
-        vertices[i] = Vertex(vertex_count-i-1);
-        edges[i] = Edge(i-1, i, 0);
-    }
-
-    return Graph(vertices, edges, vertex_count, edge_count);
+//Stops the hardware counters started before the timed loop and sets them per iteration
+void set_perf_counters(benchmark::State& state) {
+    PerfSample sample = stop_perf_counters();
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if(sample.values[i] >= 0) state.counters[perf_event_names[i]] = benchmark::Counter(sample.values[i], benchmark::Counter::kAvgIterations);
+    }
+    if(sample.values[PERF_CYCLES] > 0 && sample.values[PERF_INSTRUCTIONS] >= 0) {
+        state.counters["IPC"] = (double) sample.values[PERF_INSTRUCTIONS] / sample.values[PERF_CYCLES];
+    }
 }
 
-//Shared array of graphs for opt2 worst case benchmarks
-Graph opt2_wc_graphs[] = {
-    generate_opt2_wc_circuit(1<<6),
-    generate_opt2_wc_circuit(1<<7),
-    generate_opt2_wc_circuit(1<<8),
-    generate_opt2_wc_circuit(1<<9),
-    generate_opt2_wc_circuit(1<<10),
-    generate_opt2_wc_circuit(1<<11),
-    generate_opt2_wc_circuit(1<<12),
-};
+//PauseTiming and ResumeTiming, pausing the hardware counters too
+void pause_timing(benchmark::State& state) {
+    pause_perf_counters();
+    state.PauseTiming();
+}
+
+void resume_timing(benchmark::State& state) {
+    state.ResumeTiming();
+    resume_perf_counters();
+}
 
 
 /**
@@ -88,7 +69,7 @@ void BM_topology(benchmark::State& state) {
     typedef boost::graph_traits<BGLGraph>::vertex_descriptor BGLVertex;
 
     int index = state.range(0);
-    Graph graph = graphs[index];
+    Graph graph = random_fixture(index).graph;
 
     Edge *edges = graph.edges;
     Vertex *vertices = graph.vertices;
@@ -108,15 +89,18 @@ void BM_topology(benchmark::State& state) {
         add_edge(edge->from, edge->to, g);
     }
 
+    start_perf_counters();
     for(auto _ : state) {
-        state.PauseTiming();
+        pause_timing(state);
         std::vector<BGLVertex> sorted_vertices;
-        state.ResumeTiming();
+        resume_timing(state);
 
         topological_sort(g, std::back_inserter(sorted_vertices));
     }
+    set_perf_counters(state);
 
     state.SetComplexityN(graph.edge_count);
+    set_graph_counters(state, graph, false);
 }
 
 /**
@@ -125,13 +109,16 @@ void BM_topology(benchmark::State& state) {
  */
 void BM_cp(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = graphs[index];
+    Graph graph = random_fixture(index).graph;
     int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    start_perf_counters();
     for(auto _ : state) {
         cp(graph, deltas);
     }
+    set_perf_counters(state);
     free(deltas);
     state.SetComplexityN(graph.edge_count);
+    set_graph_counters(state, graph, false);
 }
 
 /**
@@ -141,25 +128,26 @@ void BM_cp(benchmark::State& state) {
  */
 void BM_wd(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = graphs[index];
+    Graph graph = random_fixture(index).graph;
+    start_perf_counters();
     for(auto _ : state) {
         WDEntry *WD = wd(graph);
 
-        state.PauseTiming();
+        pause_timing(state);
         free(WD);
-        state.ResumeTiming();
+        resume_timing(state);
     }
+    set_perf_counters(state);
     state.SetComplexityN(graph.vertex_count * graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
 }
 
 /**
- * Benchmark bellman algorithm when solving a system of linear inequalities, just like in the OPT1 algorithm, using the original clock period as the target c.
- * - O(V^3): bellman is O(V*E) with the max E being V^2 (max inequalities)
- * - Around 0.2 O(V^3) when adding all the inequalities
-*/
-void BM_bellman_full(benchmark::State& state) {
-    int index = state.range(0);
-    Graph graph = graphs[index];
+ * Constraints of OPT1 for the original clock period of a random fixture, with every 7.2 inequality (none skipped).
+ * The edges of the returned graph must be freed.
+ */
+Graph bellman_full_graph(int index) {
+    Graph graph = random_fixture(index).graph;
     Edge *edges = graph.edges;
     Vertex *vertices = graph.vertices;
     int vertex_count = graph.vertex_count;
@@ -198,28 +186,83 @@ void BM_bellman_full(benchmark::State& state) {
         opt_edges[k] = edge;
         ++k;
     }
+    free(opt_edges1);
 
-    Graph bell_graph(vertices, opt_edges, vertex_count, opt_edge_count);
-    int *distance = (int *) malloc(sizeof(int) * (vertex_count + 1));
+    return Graph(vertices, opt_edges, vertex_count, opt_edge_count);
+}
 
+//Fixtures of BM_bellman_full_parallel: up to 2^10 vertices, the constraints are about V^2 edges and Bellman-Ford O(V^3)
+const int bellman_full_max_index = 7;
+Graph bellman_full_graphs[bellman_full_max_index+1];
+bool bellman_full_built[bellman_full_max_index+1] = {};
+
+//bellman_full_graph of a fixture, built once for every thread count and kept until the end of the run
+Graph &bellman_full_fixture(int index) {
+    if(!bellman_full_built[index]) {
+        bellman_full_graphs[index] = bellman_full_graph(index);
+        bellman_full_built[index] = true;
+    }
+    return bellman_full_graphs[index];
+}
+
+/**
+ * Benchmark bellman algorithm when solving a system of linear inequalities, just like in the OPT1 algorithm, using the original clock period as the target c.
+ * - O(V^3): bellman is O(V*E) with the max E being V^2 (max inequalities)
+ * - Around 0.2 O(V^3) when adding all the inequalities
+*/
+void BM_bellman_full(benchmark::State& state) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    Graph bell_graph = bellman_full_graph(index);
+    int *distance = (int *) malloc(sizeof(int) * (graph.vertex_count + 1));
+
+    start_perf_counters();
     for(auto _ : state) {
         bellman(bell_graph, distance);
     }
+    set_perf_counters(state);
 
-    free(opt_edges);
+    free(bell_graph.edges);
     free(distance);
 
     state.SetComplexityN(pow(graph.vertex_count, 3));
-} 
+    set_graph_counters(state, graph, true);
+}
+
+/**
+ * Benchmark bellman_parallel on the constraints of BM_bellman_full, the second argument being the thread count.
+ * - O(V^3) work, split among the threads
+ * - Wall time, the threads are started by the benchmarked call
+ */
+void BM_bellman_full_parallel(benchmark::State& state) {
+    int index = state.range(0);
+    int thread_count = state.range(1);
+    Graph graph = random_fixture(index).graph;
+    Graph &bell_graph = bellman_full_fixture(index);
+    int *distance = (int *) malloc(sizeof(int) * (graph.vertex_count + 1));
+
+    start_perf_counters();
+    for(auto _ : state) {
+        bellman_parallel(bell_graph, distance, thread_count);
+    }
+    set_perf_counters(state);
+
+    free(distance);
+
+    state.counters["threads"] = thread_count;
+    state.SetComplexityN(pow(graph.vertex_count, 3));
+    set_graph_counters(state, graph, true);
+}
+
 void BM_bellman(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = graphs[index];
+    Graph graph = random_fixture(index).graph;
     Edge *edges = graph.edges;
     Vertex *vertices = graph.vertices;
     int vertex_count = graph.vertex_count;
     int edge_count = graph.edge_count;
 
-    int c = retimings[index];
+    int c = fixture_period(random_fixture(index));
 
     WDEntry *WD = wd(graph);
 
@@ -254,14 +297,17 @@ void BM_bellman(benchmark::State& state) {
     Graph bell_graph(vertices, opt_edges, vertex_count, opt_edge_count);
     int *distance = (int *) malloc(sizeof(int) * (vertex_count + 1));
 
+    start_perf_counters();
     for(auto _ : state) {
         bellman(bell_graph, distance);
     }
+    set_perf_counters(state);
 
     free(opt_edges);
     free(distance);
 
     state.SetComplexityN(pow(graph.vertex_count, 3));
+    set_graph_counters(state, graph, true);
 }
 
 /**
@@ -271,23 +317,52 @@ void BM_bellman(benchmark::State& state) {
  */
 void BM_opt1(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = graphs[index];
+    Graph graph = random_fixture(index).graph;
     //printf("vertices: %d\tedges: %d\n", graph.vertex_count, graph.edge_count);
+    start_perf_counters();
     for(auto _ : state) {
 
         WDEntry *WD = wd(graph);
         OptResult result = opt1(graph, WD);
 
-        state.PauseTiming();
+        pause_timing(state);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(WD);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(pow(graph.vertex_count, 3) * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
+}
+
+/**
+ * Benchmark opt1 sweeping the candidates downwards
+ * - O(V^2 * log(V)) constraints added, each moving the vertices it reaches once
+ * - Faster than opt1 when the optimum is near the top of the candidates
+ */
+void BM_opt1_sweep(benchmark::State& state) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+
+        WDEntry *WD = wd(graph);
+        OptResult result = opt1_sweep(graph, WD);
+
+        pause_timing(state);
         if(result.r) {
-            retimings[index] = result.c;
             free(result.graph.vertices);
             free(result.graph.edges);
         }
         free(WD);
-        state.ResumeTiming();
+        resume_timing(state);
     }
+    set_perf_counters(state);
     state.SetComplexityN(pow(graph.vertex_count, 3) * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
 }
 
 /**
@@ -297,22 +372,25 @@ void BM_opt1(benchmark::State& state) {
  */
 void BM_feas(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = graphs[index];
-    int target_c = retimings[index];
+    Graph graph = random_fixture(index).graph;
+    int target_c = fixture_period(random_fixture(index));
     int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    start_perf_counters();
     for(auto _ : state) {
 
         FeasResult feas_result = feas(graph, target_c, deltas);
         
-        state.PauseTiming();
+        pause_timing(state);
         if(feas_result.r) { 
                 free(feas_result.graph.vertices);
                 free(feas_result.graph.edges);
         }
-        state.ResumeTiming();
+        resume_timing(state);
     }
+    set_perf_counters(state);
     free(deltas);
     state.SetComplexityN(graph.vertex_count * graph.edge_count);
+    set_graph_counters(state, graph, false);
 }
 
 /**
@@ -321,21 +399,24 @@ void BM_feas(benchmark::State& state) {
  */
 void BM_opt2(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = graphs[index];
+    Graph graph = random_fixture(index).graph;
+    start_perf_counters();
     for(auto _ : state) {
 
         WDEntry *WD = wd(graph);
         OptResult result = opt2(graph, WD);
 
-        state.PauseTiming();
+        pause_timing(state);
         if(result.r) {
             free(result.graph.vertices);
             free(result.graph.edges);
         }
         free(WD);
-        state.ResumeTiming();
+        resume_timing(state);
     }
+    set_perf_counters(state);
     state.SetComplexityN(graph.vertex_count * graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
 }
 
 /**
@@ -343,21 +424,24 @@ void BM_opt2(benchmark::State& state) {
  */
 void BM_opt2_opt2_wc(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = opt2_wc_graphs[index];
+    Graph graph = opt2_wc_fixture(index).graph;
+    start_perf_counters();
     for(auto _ : state) {
 
         WDEntry *WD = wd(graph);
         OptResult result = opt2(graph, WD);
 
-        state.PauseTiming();
+        pause_timing(state);
         if(result.r) {
             free(result.graph.vertices);
             free(result.graph.edges);
         }
         free(WD);
-        state.ResumeTiming();
+        resume_timing(state);
     }
+    set_perf_counters(state);
     state.SetComplexityN(graph.vertex_count * graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
 }
 
 /**
@@ -365,51 +449,339 @@ void BM_opt2_opt2_wc(benchmark::State& state) {
  */
 void BM_opt1_opt2_wc(benchmark::State& state) {
     int index = state.range(0);
-    Graph graph = opt2_wc_graphs[index];
+    Graph graph = opt2_wc_fixture(index).graph;
+    start_perf_counters();
     for(auto _ : state) {
 
         WDEntry *WD = wd(graph);
         OptResult result = opt1(graph, WD);
 
-        state.PauseTiming();
+        pause_timing(state);
         if(result.r) {
             free(result.graph.vertices);
             free(result.graph.edges);
         }
         free(WD);
-        state.ResumeTiming();
+        resume_timing(state);
     }
+    set_perf_counters(state);
     state.SetComplexityN(pow(graph.vertex_count, 3) * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
+}
+
+/**
+ * Benchmark maximum cycle ratio algorithm (Howard)
+ * - Nearly O(E) per iteration, few iterations in practice
+ */
+void BM_cycle_ratio(benchmark::State& state) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(max_cycle_ratio(graph));
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(graph.edge_count);
+    set_graph_counters(state, graph, false);
+}
+
+/**
+ * Benchmark multilevel algorithm
+ * - O(E * log(V) * log(C)) per level, plus WD and OPT2 on the coarsest graph
+ */
+void BM_multilevel(benchmark::State& state) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+
+        MultilevelResult result = multilevel(graph);
+
+        pause_timing(state);
+        free(result.graph.vertices);
+        free(result.graph.edges);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, false);
+}
+
+/**
+ * Benchmark min area algorithm, at the optimal clock period
+ * - Cost scaling: O(V * E * log(V * C)) at worst, with V and E of the 7.1/7.2 constraints
+ */
+void BM_min_area(benchmark::State& state) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    WDEntry *WD = wd(graph);
+    OptResult opt_result = opt2(graph, WD);
+    if(opt_result.r) {
+        free(opt_result.graph.vertices);
+        free(opt_result.graph.edges);
+    }
+    start_perf_counters();
+    for(auto _ : state) {
+
+        OptResult result = min_area(graph, WD, opt_result.c);
+
+        pause_timing(state);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    free(WD);
+    state.SetComplexityN(pow(graph.vertex_count, 2));
+    set_graph_counters(state, graph, true);
+}
+
+/**
+ * Benchmark retiming verification of the opt2 result: check_legal, and verify_retiming with and without WD
+ * - check_legal: O(E), stops at the first violation
+ * - verify_retiming: O(E + V^2 / threads) with WD, O(V + E) without
+ */
+void BM_verify(benchmark::State& state, int mode) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    WDEntry *WD = wd(graph);
+    OptResult opt_result = opt2(graph, WD);
+    start_perf_counters();
+    for(auto _ : state) {
+        if(mode == 0) {
+            benchmark::DoNotOptimize(check_legal(graph, opt_result.graph, opt_result.c, WD));
+        } else {
+            benchmark::DoNotOptimize(verify_retiming(graph, opt_result.graph, opt_result.c, mode == 1 ? WD : nullptr));
+        }
+    }
+    set_perf_counters(state);
+    if(opt_result.r) {
+        free(opt_result.graph.vertices);
+        free(opt_result.graph.edges);
+    }
+    free(WD);
+    state.SetComplexityN(mode == 1 ? pow(graph.vertex_count, 2) : graph.edge_count);
+    set_graph_counters(state, graph, mode == 1);
+}
+
+/**
+ * Benchmark the reordering of a random fixture
+ */
+void BM_reorder(benchmark::State& state, ReorderMethod method) {
+    int index = state.range(0);
+    Graph graph = random_fixture(index).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+        ReorderedGraph reordered = reorder_graph(graph, method);
+
+        pause_timing(state);
+        free_reordered_graph(reordered);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(graph.edge_count * log(graph.edge_count));
+    set_graph_counters(state, graph, false);
+}
+
+/**
+ * Benchmark cp, wd, opt2 and check_legal on a random fixture in its generated order (method -1) or reordered
+ * The reordering itself is not timed, see BM_reorder.
+ */
+void BM_reordered_pipeline(benchmark::State& state, int method) {
+    int index = state.range(0);
+    Graph original = random_fixture(index).graph;
+    ReorderedGraph reordered;
+    if(method >= 0) reordered = reorder_graph(original, (ReorderMethod) method);
+    Graph graph = method >= 0 ? reordered.graph : original;
+    int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    start_perf_counters();
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(cp(graph, deltas));
+        WDEntry *WD = wd(graph);
+        OptResult result = opt2(graph, WD);
+        if(result.r) benchmark::DoNotOptimize(check_legal(graph, result.graph, result.c, WD));
+
+        pause_timing(state);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(WD);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    free(deltas);
+    if(method >= 0) free_reordered_graph(reordered);
+    state.SetComplexityN(graph.vertex_count * graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
+}
+
+/**
+ * Benchmarks of the structured circuit families, registered in main for each family.
+ * Same complexities as the random graph benchmarks.
+ */
+void BM_family_cp(benchmark::State& state, int family) {
+    Graph graph = family_fixture(family, state.range(0)).graph;
+    int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    start_perf_counters();
+    for(auto _ : state) {
+        cp(graph, deltas);
+    }
+    set_perf_counters(state);
+    free(deltas);
+    state.SetComplexityN(graph.edge_count);
+    set_graph_counters(state, graph, false);
+}
+
+void BM_family_wd(benchmark::State& state, int family) {
+    Graph graph = family_fixture(family, state.range(0)).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+        WDEntry *WD = wd(graph);
+
+        pause_timing(state);
+        free(WD);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(graph.vertex_count * graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
+}
+
+void BM_family_opt1(benchmark::State& state, int family) {
+    Graph graph = family_fixture(family, state.range(0)).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+
+        WDEntry *WD = wd(graph);
+        OptResult result = opt1(graph, WD);
+
+        pause_timing(state);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(WD);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(pow(graph.vertex_count, 3) * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
+}
+
+void BM_family_opt2(benchmark::State& state, int family) {
+    int index = state.range(0);
+    Graph graph = family_fixture(family, index).graph;
+    start_perf_counters();
+    for(auto _ : state) {
+
+        WDEntry *WD = wd(graph);
+        OptResult result = opt2(graph, WD);
+
+        pause_timing(state);
+        if(result.r) {
+            free(result.graph.vertices);
+            free(result.graph.edges);
+        }
+        free(WD);
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    state.SetComplexityN(graph.vertex_count * graph.edge_count * log(graph.vertex_count));
+    set_graph_counters(state, graph, true);
+}
+
+//Uses the optimal clock period as target
+void BM_family_feas(benchmark::State& state, int family) {
+    int index = state.range(0);
+    Graph graph = family_fixture(family, index).graph;
+    int target_c = fixture_period(family_fixture(family, index));
+    int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
+    start_perf_counters();
+    for(auto _ : state) {
+
+        FeasResult feas_result = feas(graph, target_c, deltas);
+
+        pause_timing(state);
+        if(feas_result.r) {
+            free(feas_result.graph.vertices);
+            free(feas_result.graph.edges);
+        }
+        resume_timing(state);
+    }
+    set_perf_counters(state);
+    free(deltas);
+    state.SetComplexityN(graph.vertex_count * graph.edge_count);
+    set_graph_counters(state, graph, false);
+}
+
+void register_family_benchmarks() {
+    typedef void (*FamilyBenchmark)(benchmark::State&, int);
+    const char *names[] = { "BM_family_cp", "BM_family_wd", "BM_family_opt1", "BM_family_opt2", "BM_family_feas" };
+    FamilyBenchmark benchmarks[] = { BM_family_cp, BM_family_wd, BM_family_opt1, BM_family_opt2, BM_family_feas };
+    for (int b = 0; b < 5; ++b) {
+        for (int f = 0; f < circuit_family_count; ++f) {
+            std::string name = std::string(names[b]) + "/" + circuit_family_names[f];
+            benchmark::RegisterBenchmark(name.c_str(), benchmarks[b], f)->DenseRange(0, family_size_max_index)->Complexity(benchmark::oN);
+        }
+    }
 }
 
 //BENCHMARK(BM_bellman_full)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK(BM_bellman_full_parallel)->ArgsProduct({benchmark::CreateDenseRange(0, bellman_full_max_index, 1), {1, 2, 4, 8}})->UseRealTime();
 
 BENCHMARK(BM_topology)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 BENCHMARK(BM_cp)      ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK(BM_cycle_ratio)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 
 BENCHMARK(BM_wd)      ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 BENCHMARK(BM_opt1)    ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK(BM_opt1_sweep)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 BENCHMARK(BM_bellman) ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 
 BENCHMARK(BM_feas)    ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 BENCHMARK(BM_opt2)    ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
 
+BENCHMARK(BM_min_area)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+
+BENCHMARK_CAPTURE(BM_verify, check_legal, 0)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_verify, wd, 1)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_verify, no_wd, 2)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+
+BENCHMARK_CAPTURE(BM_reorder, levels, REORDER_LEVELS)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_reorder, rcm, REORDER_RCM)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_reordered_pipeline, original, -1)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_reordered_pipeline, levels, REORDER_LEVELS)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_reordered_pipeline, rcm, REORDER_RCM)->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+
+BENCHMARK(BM_multilevel)    ->DenseRange(0, graph_max_index)->Complexity(benchmark::oN);
+
 BENCHMARK(BM_opt2_opt2_wc)    ->DenseRange(0, opt2_wc_graph_max_index)->Complexity(benchmark::oN);
 BENCHMARK(BM_opt1_opt2_wc)    ->DenseRange(0, opt2_wc_graph_max_index)->Complexity(benchmark::oN);
 
 //BENCHMARK_MAIN();
+//Results go to performance_bench.json unless --benchmark_out is given, compare runs with compile/compare_bench.py
 int main(int argc, char** argv)
 {
-    for(int i = 0; i < graph_count; ++i) {
-        int zero_edges = 0;
-        for(int j = 0; j < graphs[i].edge_count; ++j) {
-            if(graphs[i].edges[j].weight == 0)
-                ++zero_edges;
-        }
-        printf("Graph %d: vertices: %d, edges: %d, zero edges: %d\n", i, graphs[i].vertex_count, graphs[i].edge_count, zero_edges);
+    std::vector<char *> args(argv, argv + argc);
+    bool has_out = false;
+    for(int i = 1; i < argc; ++i) {
+        if(std::string(argv[i]).rfind("--benchmark_out=", 0) == 0) has_out = true;
+    }
+    char out_arg[] = "--benchmark_out=performance_bench.json";
+    char format_arg[] = "--benchmark_out_format=json";
+    if(!has_out) {
+        args.push_back(out_arg);
+        args.push_back(format_arg);
     }
+    int arg_count = args.size();
 
-    ::benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("fixture_seed", std::to_string(FIXTURE_SEED));
+    benchmark::AddCustomContext("fixture_dir", fixture_dir());
+    benchmark::AddCustomContext("perf_counters", perf_counters_status());
+    register_family_benchmarks();
+    ::benchmark::Initialize(&arg_count, args.data());
     ::benchmark::RunSpecifiedBenchmarks();
 }
-
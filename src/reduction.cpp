@@ -0,0 +1,249 @@
+#ifndef REDUCTION
+#define REDUCTION
+
+#include <vector>
+#include <algorithm>
+#include "types.h"
+
+//#define REDUCTIONDEBUG
+
+#ifdef REDUCTIONDEBUG
+#include <iostream>
+#endif
+
+// Arc incident to an eliminated vertex, as it was when the vertex got eliminated.
+struct EliminatedArc {
+    int vertex; //neighbour (original id)
+    int weight; //register count of the arc
+};
+
+// Record of an eliminated vertex, needed to expand a retiming of the reduced graph back.
+struct Elimination {
+    int vertex; //eliminated vertex (original id)
+    int in_begin, in_end; //range of incoming arcs in ReducedGraph::arcs
+    int out_begin, out_end; //range of outgoing arcs in ReducedGraph::arcs
+};
+
+struct ReducedGraph {
+    Graph graph; //reduced graph
+    int *vertex_map; //original vertex id -> reduced vertex id, -1 if eliminated
+    int *original; //reduced vertex id -> original vertex id
+    std::vector<Elimination> eliminations; //in elimination order
+    std::vector<EliminatedArc> arcs;
+};
+
+/**
+ * GRAPH REDUCTION
+ * Shrinks the graph without changing its optimal clock period:
+ * - Zero delay vertices with a single fanin or a single fanout (buffers, wires, dangling vertices) are eliminated,
+ *   connecting each of their fanins directly to each of their fanouts with the added register count.
+ *   Applied until no such vertex is left, so whole chains collapse.
+ * - Parallel edges are dominated by the one with the least registers, only that one is kept.
+ * - Self loops with registers can never be violated and are removed.
+ * A legal retiming of the reduced graph is expanded back with expand_retiming.
+ * Returns a ReducedGraph, to be freed with free_reduced_graph.
+ */
+ReducedGraph reduce_graph(Graph &graph) {
+    int vertex_count = graph.vertex_count;
+    Vertex *vertices = graph.vertices;
+
+    ReducedGraph reduced;
+
+    std::vector<Edge> edges(graph.edges, graph.edges + graph.edge_count);
+    std::vector<bool> alive_edge(edges.size(), true);
+    std::vector<bool> eliminated(vertex_count, false);
+    std::vector<std::vector<int>> in_edges(vertex_count);
+    std::vector<std::vector<int>> out_edges(vertex_count);
+
+    for (int i = 0; i < (int) edges.size(); ++i) {
+        Edge edge = edges[i];
+        if(edge.from == edge.to && edge.weight > 0) {
+            alive_edge[i] = false;
+            continue;
+        }
+        out_edges[edge.from].push_back(i);
+        in_edges[edge.to].push_back(i);
+    }
+
+    //drops dead edges from an adjacency list and returns its live size
+    auto compact = [&](std::vector<int> &list) {
+        int k = 0;
+        for (int i = 0; i < (int) list.size(); ++i) {
+            if(alive_edge[list[i]]) list[k++] = list[i];
+        }
+        list.resize(k);
+        return k;
+    };
+
+    auto reducible = [&](int v) {
+        if(eliminated[v] || vertices[v].weight != 0) return false;
+        int in_degree = compact(in_edges[v]);
+        int out_degree = compact(out_edges[v]);
+        return in_degree <= 1 || out_degree <= 1;
+    };
+
+    std::vector<int> worklist;
+    for (int v = vertex_count-1; v >= 0; --v) {
+        if(vertices[v].weight == 0) worklist.push_back(v);
+    }
+
+    while(!worklist.empty()) {
+        int x = worklist.back();
+        worklist.pop_back();
+        if(!reducible(x)) continue;
+
+        //a zero weight self loop is a combinational cycle, leave it to the caller
+        bool zero_loop = false;
+        for (int e: out_edges[x]) {
+            if(edges[e].to == x) zero_loop = true;
+        }
+        if(zero_loop) continue;
+
+        Elimination elimination;
+        elimination.vertex = x;
+        elimination.in_begin = reduced.arcs.size();
+        for (int e: in_edges[x]) {
+            reduced.arcs.push_back({edges[e].from, edges[e].weight});
+            alive_edge[e] = false;
+        }
+        elimination.in_end = elimination.out_begin = reduced.arcs.size();
+        for (int e: out_edges[x]) {
+            reduced.arcs.push_back({edges[e].to, edges[e].weight});
+            alive_edge[e] = false;
+        }
+        elimination.out_end = reduced.arcs.size();
+        reduced.eliminations.push_back(elimination);
+        eliminated[x] = true;
+        in_edges[x].clear();
+        out_edges[x].clear();
+
+        //connect every fanin to every fanout, at most one side has more than one vertex
+        for (int i = elimination.in_begin; i < elimination.in_end; ++i) {
+            for (int j = elimination.out_begin; j < elimination.out_end; ++j) {
+                int from = reduced.arcs[i].vertex;
+                int to = reduced.arcs[j].vertex;
+                int weight = reduced.arcs[i].weight + reduced.arcs[j].weight;
+                if(from == to && weight > 0) continue;
+
+                alive_edge.push_back(true);
+                edges.push_back(Edge(from, to, weight));
+                out_edges[from].push_back(edges.size()-1);
+                in_edges[to].push_back(edges.size()-1);
+            }
+        }
+
+        //neighbours may have become reducible
+        for (int i = elimination.in_begin; i < elimination.out_end; ++i) {
+            worklist.push_back(reduced.arcs[i].vertex);
+        }
+
+#ifdef REDUCTIONDEBUG
+        printf("Eliminated %d (in: %d, out: %d)\n", x, elimination.in_end - elimination.in_begin, elimination.out_end - elimination.out_begin);
+#endif
+    }
+
+    //renumber the remaining vertices
+    reduced.vertex_map = (int *) malloc(sizeof(int) * vertex_count);
+    int reduced_vertex_count = 0;
+    for (int v = 0; v < vertex_count; ++v) {
+        reduced.vertex_map[v] = eliminated[v] ? -1 : reduced_vertex_count++;
+    }
+    reduced.original = (int *) malloc(sizeof(int) * reduced_vertex_count);
+    Vertex *reduced_vertices = (Vertex *) malloc(sizeof(Vertex) * reduced_vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        if(eliminated[v]) continue;
+        reduced.original[reduced.vertex_map[v]] = v;
+        reduced_vertices[reduced.vertex_map[v]] = vertices[v];
+    }
+
+    //keep the least weighted edge of each group of parallel edges
+    std::vector<Edge> reduced_edges_v;
+    for (int i = 0; i < (int) edges.size(); ++i) {
+        if(alive_edge[i]) {
+            Edge edge = edges[i];
+            reduced_edges_v.push_back(Edge(reduced.vertex_map[edge.from], reduced.vertex_map[edge.to], edge.weight));
+        }
+    }
+    std::sort(reduced_edges_v.begin(), reduced_edges_v.end(), [](const Edge &a, const Edge &b) {
+        if(a.from != b.from) return a.from < b.from;
+        if(a.to != b.to) return a.to < b.to;
+        return a.weight < b.weight;
+    });
+
+    Edge *reduced_edges = (Edge *) malloc(sizeof(Edge) * reduced_edges_v.size());
+    int reduced_edge_count = 0;
+    for (int i = 0; i < (int) reduced_edges_v.size(); ++i) {
+        if(i > 0 && reduced_edges_v[i].from == reduced_edges_v[i-1].from && reduced_edges_v[i].to == reduced_edges_v[i-1].to)
+            continue;
+        reduced_edges[reduced_edge_count++] = reduced_edges_v[i];
+    }
+
+    reduced.graph = Graph(reduced_vertices, reduced_edges, reduced_vertex_count, reduced_edge_count);
+
+#ifdef REDUCTIONDEBUG
+    printf("Reduced vertices: %d -> %d, edges: %d -> %d\n", vertex_count, reduced_vertex_count, graph.edge_count, reduced_edge_count);
+#endif
+
+    return reduced;
+}
+
+/**
+ * Expands a retiming of the reduced graph back into a retiming of the original graph.
+ * retimed: retimed reduced graph, vertex weights being r(v) as returned by opt1, opt2 or feas.
+ * Eliminated vertices are retimed with all of the registers of their fanin pushed to their fanouts.
+ * Returns the retimed original graph (same layout as OptResult::graph).
+ */
+Graph expand_retiming(ReducedGraph &reduced, Graph &graph, Graph &retimed) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        int reduced_v = reduced.vertex_map[v];
+        retimed_vertices[v] = Vertex(reduced_v >= 0 ? retimed.vertices[reduced_v].weight : 0);
+    }
+
+    //undo eliminations in reverse order so that the neighbours of each vertex are already retimed
+    for (int i = reduced.eliminations.size()-1; i >= 0; --i) {
+        Elimination elimination = reduced.eliminations[i];
+        int r = 0;
+        if(elimination.in_end > elimination.in_begin) {
+            //r(x) = max(r(u) - w(u, x)), every fanin edge keeps >= 0 registers
+            r = -MAXINT;
+            for (int j = elimination.in_begin; j < elimination.in_end; ++j) {
+                EliminatedArc arc = reduced.arcs[j];
+                r = std::max(r, retimed_vertices[arc.vertex].weight - arc.weight);
+            }
+        } else if(elimination.out_end > elimination.out_begin) {
+            //r(x) = min(r(v) + w(x, v)), every fanout edge keeps >= 0 registers
+            r = MAXINT;
+            for (int j = elimination.out_begin; j < elimination.out_end; ++j) {
+                EliminatedArc arc = reduced.arcs[j];
+                r = std::min(r, retimed_vertices[arc.vertex].weight + arc.weight);
+            }
+        }
+        retimed_vertices[elimination.vertex] = Vertex(r);
+    }
+
+    //wr(e) = w(e) + r(v) - r(u)
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        retimed_edges[i] = Edge(from, to, edges[i].weight + retimed_vertices[to].weight - retimed_vertices[from].weight);
+    }
+
+    return Graph(retimed_vertices, retimed_edges, vertex_count, edge_count);
+}
+
+void free_reduced_graph(ReducedGraph &reduced) {
+    free(reduced.graph.vertices);
+    free(reduced.graph.edges);
+    free(reduced.vertex_map);
+    free(reduced.original);
+    reduced.eliminations.clear();
+    reduced.arcs.clear();
+}
+
+#endif
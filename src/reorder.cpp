@@ -0,0 +1,210 @@
+#ifndef REORDER
+#define REORDER
+
+#include <vector>
+#include <algorithm>
+#include "types.h"
+
+//#define REORDERDEBUG
+
+#ifdef REORDERDEBUG
+#include <iostream>
+#endif
+
+enum ReorderMethod { REORDER_LEVELS, REORDER_RCM };
+const char *reorder_method_names[] = { "levels", "rcm" };
+
+struct ReorderedGraph {
+    Graph graph; //renumbered graph, edges sorted by source
+    int *vertex_map; //original vertex id -> new vertex id
+    int *original; //new vertex id -> original vertex id
+};
+
+//Vertices in topological order of the 0 weight edges, taken level by level (FIFO Kahn), so the fanouts of a vertex
+//end up close to each other. Vertices on 0 weight cycles go last, in their original order.
+std::vector<int> levels_order(Graph &graph) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    std::vector<int> offsets(vertex_count+1, 0);
+    std::vector<int> in_degree(vertex_count, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        if(edges[i].weight != 0) continue;
+        ++offsets[edges[i].from+1];
+        ++in_degree[edges[i].to];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> fanouts(offsets[vertex_count]);
+    std::vector<int> position(offsets.begin(), offsets.end()-1);
+    for (int i = 0; i < edge_count; ++i) {
+        if(edges[i].weight == 0) fanouts[position[edges[i].from]++] = edges[i].to;
+    }
+
+    std::vector<int> order;
+    order.reserve(vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        if(in_degree[v] == 0) order.push_back(v);
+    }
+    for (int head = 0; head < (int) order.size(); ++head) {
+        int u = order[head];
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            if(--in_degree[fanouts[i]] == 0) order.push_back(fanouts[i]);
+        }
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        if(in_degree[v] > 0) order.push_back(v);
+    }
+    return order;
+}
+
+//Reverse Cuthill-McKee order of the graph taken as undirected: BFS from a least degree vertex of each component,
+//neighbours visited by increasing degree, then reversed. Keeps the vertices of an edge at a small id distance.
+std::vector<int> rcm_order(Graph &graph) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        ++offsets[edges[i].from+1];
+        ++offsets[edges[i].to+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> neighbours(offsets[vertex_count]);
+    std::vector<int> position(offsets.begin(), offsets.end()-1);
+    for (int i = 0; i < edge_count; ++i) {
+        neighbours[position[edges[i].from]++] = edges[i].to;
+        neighbours[position[edges[i].to]++] = edges[i].from;
+    }
+    auto degree = [&](int v) { return offsets[v+1] - offsets[v]; };
+    for (int v = 0; v < vertex_count; ++v) {
+        std::sort(neighbours.begin() + offsets[v], neighbours.begin() + offsets[v+1], [&](int a, int b) {
+            return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+        });
+    }
+
+    //component starts, least degree first
+    std::vector<int> starts(vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        starts[v] = v;
+    }
+    std::stable_sort(starts.begin(), starts.end(), [&](int a, int b) { return degree(a) < degree(b); });
+
+    std::vector<int> order;
+    order.reserve(vertex_count);
+    std::vector<bool> visited(vertex_count, false);
+    for (int start: starts) {
+        if(visited[start]) continue;
+        visited[start] = true;
+        order.push_back(start);
+        for (int head = order.size()-1; head < (int) order.size(); ++head) {
+            int u = order[head];
+            for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+                int v = neighbours[i];
+                if(visited[v]) continue;
+                visited[v] = true;
+                order.push_back(v);
+            }
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/**
+ * GRAPH REORDERING
+ * Renumbers the vertices so that the algorithms walking the edges (cp, the Dijkstras of wd, bellman) touch memory
+ * close to what they just touched, and the rows and columns of WD, scanned by opt1, opt2 and check_legal, follow the
+ * same order:
+ * - REORDER_LEVELS: topological levels of the 0 weight edges, the order in which cp visits the vertices.
+ * - REORDER_RCM: reverse Cuthill-McKee, for circuits with few 0 weight edges.
+ * Edges are sorted by source (then target, parallel edges keep their order), so the out edges of a vertex are
+ * contiguous. The reordered graph has the same clock period, and its results go back to the original ids with
+ * restore_retiming and restore_vertex_order.
+ * Returns a ReorderedGraph, to be freed with free_reordered_graph.
+ */
+ReorderedGraph reorder_graph(Graph &graph, ReorderMethod method = REORDER_LEVELS) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+
+    std::vector<int> order = method == REORDER_RCM ? rcm_order(graph) : levels_order(graph);
+
+    ReorderedGraph reordered;
+    reordered.vertex_map = (int *) malloc(sizeof(int) * vertex_count);
+    reordered.original = (int *) malloc(sizeof(int) * vertex_count);
+    Vertex *vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        reordered.original[v] = order[v];
+        reordered.vertex_map[order[v]] = v;
+        vertices[v] = graph.vertices[order[v]];
+    }
+
+    Edge *edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        Edge edge = graph.edges[i];
+        edges[i] = Edge(reordered.vertex_map[edge.from], reordered.vertex_map[edge.to], edge.weight);
+    }
+    std::stable_sort(edges, edges + edge_count, [](const Edge &a, const Edge &b) {
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+
+    reordered.graph = Graph(vertices, edges, vertex_count, edge_count);
+
+#ifdef REORDERDEBUG
+    long long span = 0;
+    for (int i = 0; i < edge_count; ++i) {
+        span += abs(edges[i].to - edges[i].from);
+    }
+    printf("Reordered (%s) %d vertices, mean edge span: %.1f\n", reorder_method_names[method], vertex_count,
+            edge_count ? (double) span / edge_count : 0.0);
+#endif
+
+    return reordered;
+}
+
+/**
+ * Maps a retiming of the reordered graph back to the original graph.
+ * retimed: retimed reordered graph, vertex weights being r(v) as returned by opt1, opt2 or feas.
+ * Returns the retimed original graph (same layout as OptResult::graph, edges in the original order).
+ */
+Graph restore_retiming(ReorderedGraph &reordered, Graph &graph, Graph &retimed) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *edges = graph.edges;
+
+    Vertex *retimed_vertices = (Vertex *) malloc(sizeof(Vertex) * vertex_count);
+    for (int v = 0; v < vertex_count; ++v) {
+        retimed_vertices[v] = retimed.vertices[reordered.vertex_map[v]];
+    }
+
+    //wr(e) = w(e) + r(v) - r(u)
+    Edge *retimed_edges = (Edge *) malloc(sizeof(Edge) * edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        retimed_edges[i] = Edge(from, to, edges[i].weight + retimed_vertices[to].weight - retimed_vertices[from].weight);
+    }
+
+    return Graph(retimed_vertices, retimed_edges, vertex_count, edge_count);
+}
+
+//Copies values indexed by reordered vertex (e.g. the deltas of cp) into restored, indexed by original vertex
+void restore_vertex_order(ReorderedGraph &reordered, int *values, int *restored) {
+    for (int v = 0; v < reordered.graph.vertex_count; ++v) {
+        restored[reordered.original[v]] = values[v];
+    }
+}
+
+void free_reordered_graph(ReorderedGraph &reordered) {
+    free(reordered.graph.vertices);
+    free(reordered.graph.edges);
+    free(reordered.vertex_map);
+    free(reordered.original);
+}
+
+#endif
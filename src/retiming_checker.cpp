@@ -1,6 +1,9 @@
 #ifndef RETCHECKER
 #define RETCHECKER
 
+#include <thread>
+#include <vector>
+#include <algorithm>
 #include "types.h"
 
 //#define DEBUGRETCHECKER
@@ -52,4 +55,152 @@ bool check_legal(Graph &graph, Graph &retimed, int c, WDEntry *WD) {
     return true;
 }
 
+struct VerifyResult {
+    bool r; //legal retiming with clock period <= c
+    int period; //actual clock period of the retimed graph, -1 if it has a 0 weight cycle
+    long long w1_violations; //negative weight edges
+    long long c7_1_violations; //edges with r(u) - r(v) > w(e)
+    long long c7_2_violations; //pairs with D(u, v) > c and r(u) - r(v) > W(u, v) - 1
+};
+
+//Counts W1 and 7.1 violations of the edges begin to end-1, branch free so that the loop vectorizes
+void count_edge_violations(Graph &graph, Graph &retimed, int begin, int end, long long *w1, long long *c7_1) {
+    const Edge *edges = graph.edges;
+    const Edge *retimed_edges = retimed.edges;
+    const Vertex *retimed_vertices = retimed.vertices;
+    long long w1_count = 0;
+    long long c7_1_count = 0;
+    for (int i = begin; i < end; ++i) {
+        w1_count += retimed_edges[i].weight < 0;
+        c7_1_count += retimed_vertices[edges[i].from].weight - retimed_vertices[edges[i].to].weight > edges[i].weight;
+    }
+    *w1 = w1_count;
+    *c7_1 = c7_1_count;
+}
+
+//Counts 7.2 violations of the WD rows begin to end-1, reading the matrix row by row
+long long count_7_2_violations(Graph &retimed, int c, WDEntry *WD, int begin, int end) {
+    int vertex_count = retimed.vertex_count;
+    const Vertex *retimed_vertices = retimed.vertices;
+    long long count = 0;
+    for (int u = begin; u < end; ++u) {
+        const WDEntry *row = &WD[(long long) u * vertex_count];
+        int ru = retimed_vertices[u].weight;
+        for (int v = 0; v < vertex_count; ++v) {
+            count += (row[v].D > c) & (ru - retimed_vertices[v].weight > row[v].W - 1);
+        }
+    }
+    return count;
+}
+
+/**
+ * Clock period of the base graph retimed: CP over the retimed edges with the delays of the base graph,
+ * with Kahn's topological order of the 0 weight edges. Returns -1 if there is a 0 weight cycle. O(V + E).
+ */
+int retimed_period(Graph &graph, Graph &retimed) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    Edge *retimed_edges = retimed.edges;
+
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (int i = 0; i < edge_count; ++i) {
+        if(retimed_edges[i].weight == 0) ++offsets[retimed_edges[i].from+1];
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<int> targets(offsets[vertex_count]);
+    std::vector<int> in_degree(vertex_count, 0);
+    {
+        std::vector<int> position(offsets.begin(), offsets.end()-1);
+        for (int i = 0; i < edge_count; ++i) {
+            if(retimed_edges[i].weight != 0) continue;
+            targets[position[retimed_edges[i].from]++] = retimed_edges[i].to;
+            ++in_degree[retimed_edges[i].to];
+        }
+    }
+
+    std::vector<int> deltas(vertex_count, 0);
+    std::vector<int> ready;
+    for (int v = 0; v < vertex_count; ++v) {
+        if(in_degree[v] == 0) ready.push_back(v);
+    }
+    int c = 0;
+    int sorted = 0;
+    while(!ready.empty()) {
+        int u = ready.back();
+        ready.pop_back();
+        ++sorted;
+        deltas[u] += graph.vertices[u].weight;
+        c = std::max(c, deltas[u]);
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            int v = targets[i];
+            deltas[v] = std::max(deltas[v], deltas[u]);
+            if(--in_degree[v] == 0) ready.push_back(v);
+        }
+    }
+
+    return sorted == vertex_count ? c : -1;
+}
+
+/**
+ * Verifies a retiming, counting every violation instead of stopping at the first one.
+ * graph: Base graph.
+ * retimed: Retimed graph (vertex weights are r, as in OptResult).
+ * c: Claimed clock period.
+ * WD: WD matrix of the base graph, or null to verify without it: the retiming is then legal if W1 and 7.1 hold
+ * and the actual period is at most c (7.2 is only the WD form of this last condition).
+ * thread_count: Threads scanning the edges and the WD rows.
+ * Returns a VerifyResult. O(E + V^2 / thread_count) with WD, O(V + E) without.
+ */
+VerifyResult verify_retiming(Graph &graph, Graph &retimed, int c, WDEntry *WD = nullptr,
+        int thread_count = std::thread::hardware_concurrency()) {
+    int vertex_count = graph.vertex_count;
+    int edge_count = graph.edge_count;
+    thread_count = std::max(1, thread_count);
+
+    std::vector<long long> w1(thread_count, 0);
+    std::vector<long long> c7_1(thread_count, 0);
+    std::vector<long long> c7_2(thread_count, 0);
+    auto scan = [&](int t) {
+        int edge_begin = (long long) edge_count * t / thread_count;
+        int edge_end = (long long) edge_count * (t+1) / thread_count;
+        count_edge_violations(graph, retimed, edge_begin, edge_end, &w1[t], &c7_1[t]);
+        if(WD) {
+            int row_begin = (long long) vertex_count * t / thread_count;
+            int row_end = (long long) vertex_count * (t+1) / thread_count;
+            c7_2[t] = count_7_2_violations(retimed, c, WD, row_begin, row_end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; ++t) {
+        threads.push_back(std::thread(scan, t));
+    }
+    scan(0);
+    VerifyResult result;
+    result.period = retimed_period(graph, retimed);
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    result.w1_violations = 0;
+    result.c7_1_violations = 0;
+    result.c7_2_violations = 0;
+    for (int t = 0; t < thread_count; ++t) {
+        result.w1_violations += w1[t];
+        result.c7_1_violations += c7_1[t];
+        result.c7_2_violations += c7_2[t];
+    }
+    result.r = result.w1_violations == 0 && result.c7_1_violations == 0 && result.c7_2_violations == 0
+            && result.period >= 0 && result.period <= c;
+
+#ifdef DEBUGRETCHECKER
+    printf("Period: %d\tW1: %lld\t7.1: %lld\t7.2: %lld\n", result.period, result.w1_violations, result.c7_1_violations,
+            result.c7_2_violations);
+#endif
+
+    return result;
+}
+
 #endif
@@ -0,0 +1,741 @@
+#ifndef RETIMINGSERVICE
+#define RETIMINGSERVICE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "types.h"
+#include "graph_io.cpp"
+#include "circuit_view.cpp"
+#include "min_area.cpp"
+#include "batch.cpp"
+
+//#define SERVICEDEBUG
+
+/**
+ * Retiming service: requests carry a circuit (a binary graph file, see graph_io.cpp) and are run asynchronously by a
+ * pool of workers, each one with its own scratch memory (see batch.cpp).
+ * WD matrices and clock period candidates are kept in an LRU cache bounded in bytes and keyed by a content hash of the
+ * circuit, so repeated queries on the same circuit, with any algorithm or target clock period, skip WD.
+ * Entries evicted from memory can be spilled to a directory as graph files with a WD section, and read back instead of
+ * computing WD again.
+ *
+ * PROTOCOL (serve_connection), over stdin/stdout or a Unix domain socket:
+ * - "<id> <algorithm> <target_c> <bytes>\n" followed by the bytes of a binary graph file. algorithm is auto, opt1, opt2,
+ *   feas or min_area, target_c the clock period for feas and min_area (ignored by the rest). A request of more than
+ *   ServiceOptions::max_request_bytes is answered with "<id> error request too large\n" and ends the connection.
+ *   Answered, maybe out of order, with "<id> ok <algorithm> <c> <none|hit|spill|miss> <latency ms> <vertex_count> r(0) r(1) ...\n"
+ *   or "<id> error <reason>\n". A circuit whose WD matrix is bigger than ServiceOptions::cache_bytes is answered with
+ *   "<id> error WD matrix does not fit in memory", one that runs out of memory with "<id> error out of memory".
+ * - "stats\n": answered with "stats <format_service_stats>\n".
+ * - "quit\n" ends the connection, "shutdown\n" also stops the server.
+ */
+
+enum ServiceAlgorithm { SERVICE_AUTO, SERVICE_OPT1, SERVICE_OPT2, SERVICE_FEAS, SERVICE_MIN_AREA };
+const char *service_algorithm_names[] = { "auto", "opt1", "opt2", "feas", "min_area" };
+const int service_algorithm_count = 5;
+
+//Where the WD matrix of a request came from
+enum WDSource { WD_NONE, WD_HIT, WD_SPILL, WD_MISS };
+const char *wd_source_names[] = { "none", "hit", "spill", "miss" };
+
+struct ServiceOptions {
+    int thread_count = std::thread::hardware_concurrency();
+    size_t cache_bytes = (size_t) 1 << 30; //also the biggest WD matrix a request can ask for
+    std::string spill_dir; //where evicted entries are spilled, none if empty
+    size_t max_request_bytes = (size_t) 1 << 30; //bigger graph files are refused before anything is allocated
+};
+
+struct ServiceResponse {
+    std::string id;
+    bool r;
+    std::string error; //reason, if r is false
+    ServiceAlgorithm algorithm; //the one used (auto resolves to opt1 or opt2)
+    int c; //clock period of the retimed circuit
+    WDSource wd_source;
+    double latency; //ms, from the request being submitted to its response
+    std::vector<int> retiming; //r(v) of each vertex
+};
+
+struct ServiceRequest {
+    std::string id;
+    ServiceAlgorithm algorithm;
+    int target_c; //clock period for feas and min_area
+    std::vector<char> data; //binary graph file
+    std::function<void(ServiceResponse &)> respond; //called from a worker thread
+    std::chrono::steady_clock::time_point submitted;
+};
+
+//FNV-1a over the 32 bit words of the circuit. O(V + E).
+uint64_t circuit_hash(CircuitView &view) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&](const int *values, int count) {
+        hash = (hash ^ (uint32_t) count) * 1099511628211ULL;
+        for (int i = 0; i < count; ++i) {
+            hash = (hash ^ (uint32_t) values[i]) * 1099511628211ULL;
+        }
+    };
+    add(view.delays, view.vertex_count);
+    add(view.from, view.edge_count);
+    add(view.to, view.edge_count);
+    add(view.weight, view.edge_count);
+    return hash;
+}
+
+//WD matrix and candidates of a circuit, with a copy of the circuit to tell hash collisions apart
+struct WDCacheEntry {
+    uint64_t hash;
+    std::vector<int> delays, from, to, weight;
+    std::vector<WDEntry> WD;
+    std::vector<int> candidates;
+
+    size_t bytes() {
+        return sizeof(WDEntry) * WD.size() + sizeof(int) * (delays.size() + 3 * from.size() + candidates.size());
+    }
+
+    bool same_circuit(CircuitView &view) {
+        return (int) delays.size() == view.vertex_count && (int) from.size() == view.edge_count
+            && std::equal(delays.begin(), delays.end(), view.delays) && std::equal(from.begin(), from.end(), view.from)
+            && std::equal(to.begin(), to.end(), view.to) && std::equal(weight.begin(), weight.end(), view.weight);
+    }
+};
+
+struct WDCacheStats {
+    long long hits;
+    long long spill_hits;
+    long long misses;
+    long long evictions;
+    long long spills;
+    size_t bytes;
+    size_t entries;
+};
+
+/**
+ * LRU cache of WDCacheEntry, bounded by the bytes of its entries. Entries are shared, an evicted entry stays alive
+ * while a worker still uses it. Spill files are written and read without holding the lock.
+ * A circuit missing from memory is loaded (from its spill file or computed) by one worker only: find marks it as
+ * pending, the other workers asking for it wait until the first one inserts it, or abandons it if it fails.
+ */
+struct WDCache {
+    std::mutex mutex;
+    std::condition_variable inserted;
+    std::unordered_set<uint64_t> pending;
+    size_t capacity;
+    std::string spill_dir;
+    std::list<std::shared_ptr<WDCacheEntry>> lru; //most recently used first
+    std::unordered_map<uint64_t, std::list<std::shared_ptr<WDCacheEntry>>::iterator> index;
+    WDCacheStats stats = {};
+
+    WDCache(size_t capacity, std::string spill_dir): capacity(capacity), spill_dir(spill_dir) {}
+
+    std::string spill_path(uint64_t hash) {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.graph", (unsigned long long) hash);
+        return spill_dir + "/" + name;
+    }
+
+    /**
+     * Entry of the circuit from memory or from its spill file, null if there is none.
+     * Unless it was in memory (WD_HIT), the caller must insert the entry, computing it if it is null.
+     */
+    std::shared_ptr<WDCacheEntry> find(uint64_t hash, CircuitView &view, WDSource *source) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true) {
+                auto it = index.find(hash);
+                if(it != index.end() && (*it->second)->same_circuit(view)) {
+                    lru.splice(lru.begin(), lru, it->second);
+                    ++stats.hits;
+                    *source = WD_HIT;
+                    return lru.front();
+                }
+                if(!pending.count(hash)) break;
+                inserted.wait(lock);
+            }
+            pending.insert(hash);
+        }
+
+        std::shared_ptr<WDCacheEntry> entry;
+        try {
+            entry = read_spill(hash, view);
+        } catch(...) {
+            abandon(hash);
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if(entry) {
+            ++stats.spill_hits;
+            *source = WD_SPILL;
+        } else {
+            ++stats.misses;
+            *source = WD_MISS;
+        }
+        return entry;
+    }
+
+    //Gives up a circuit that find marked as pending and that will not be inserted, one of the waiting workers loads it
+    void abandon(uint64_t hash) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.erase(hash);
+        }
+        inserted.notify_all();
+    }
+
+    std::shared_ptr<WDCacheEntry> read_spill(uint64_t hash, CircuitView &view) {
+        if(spill_dir.empty()) return nullptr;
+        MappedGraph mapped = map_graph(spill_path(hash));
+        if(!mapped.r) return nullptr;
+        std::shared_ptr<WDCacheEntry> entry;
+        if(mapped.WD) {
+            entry = std::make_shared<WDCacheEntry>();
+            entry->hash = hash;
+            Graph &graph = mapped.graph;
+            for (int v = 0; v < graph.vertex_count; ++v) {
+                entry->delays.push_back(graph.vertices[v].weight);
+            }
+            for (int e = 0; e < graph.edge_count; ++e) {
+                entry->from.push_back(graph.edges[e].from);
+                entry->to.push_back(graph.edges[e].to);
+                entry->weight.push_back(graph.edges[e].weight);
+            }
+            if(entry->same_circuit(view)) {
+                entry->WD.assign(mapped.WD, mapped.WD + (size_t) graph.vertex_count * graph.vertex_count);
+                entry->candidates = view_c_candidates(view, entry->WD.data(), view_period_lower_bound(view));
+            } else {
+                entry = nullptr;
+            }
+        }
+        unmap_graph(mapped);
+        return entry;
+    }
+
+    //Writes the entry as a graph file with its WD section, unless it is already there
+    void write_spill(std::shared_ptr<WDCacheEntry> &entry) {
+        std::string path = spill_path(entry->hash);
+        struct stat file_stat;
+        if(stat(path.c_str(), &file_stat) == 0) return;
+        int vertex_count = entry->delays.size();
+        int edge_count = entry->from.size();
+        std::vector<Vertex> vertices;
+        std::vector<Edge> edges;
+        for (int v = 0; v < vertex_count; ++v) {
+            vertices.push_back(Vertex(entry->delays[v]));
+        }
+        for (int e = 0; e < edge_count; ++e) {
+            edges.push_back(Edge(entry->from[e], entry->to[e], entry->weight[e]));
+        }
+        Graph graph(vertices.data(), edges.data(), vertex_count, edge_count);
+        //written under another name and renamed, so readers never see a partial file
+        std::string tmp_path = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if(write_graph(graph, tmp_path, false, entry->WD.data())) {
+            rename(tmp_path.c_str(), path.c_str());
+        } else {
+            remove(tmp_path.c_str());
+        }
+    }
+
+    //Adds the entry as the most recently used one, evicting (and spilling) the least recently used ones over capacity
+    void insert(std::shared_ptr<WDCacheEntry> entry) {
+        std::vector<std::shared_ptr<WDCacheEntry>> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.erase(entry->hash);
+            auto it = index.find(entry->hash);
+            if(it != index.end()) {
+                stats.bytes -= (*it->second)->bytes();
+                lru.erase(it->second);
+            }
+            lru.push_front(entry);
+            index[entry->hash] = lru.begin();
+            stats.bytes += entry->bytes();
+            while(stats.bytes > capacity && !lru.empty()) {
+                std::shared_ptr<WDCacheEntry> last = lru.back();
+                lru.pop_back();
+                index.erase(last->hash);
+                stats.bytes -= last->bytes();
+                ++stats.evictions;
+                evicted.push_back(last);
+            }
+            stats.entries = lru.size();
+            if(!spill_dir.empty()) stats.spills += evicted.size();
+        }
+        inserted.notify_all();
+        if(!spill_dir.empty()) {
+            for (std::shared_ptr<WDCacheEntry> &last: evicted) {
+                write_spill(last);
+            }
+        }
+    }
+
+    WDCacheStats get_stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+struct ServiceStats {
+    long long requests; //answered
+    long long errors;
+    double p50, p90, p99, max, mean; //latency, ms
+    WDCacheStats cache;
+};
+
+/**
+ * Pool of workers running the submitted requests in order of arrival.
+ * The destructor (or stop) waits for the pending requests to be answered.
+ */
+struct RetimingService {
+    ServiceOptions options;
+    WDCache cache;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<ServiceRequest> queue;
+    bool stopping;
+    std::vector<std::thread> workers;
+    std::mutex stats_mutex;
+    std::vector<double> latencies;
+    long long errors;
+
+    RetimingService(ServiceOptions options): options(options), cache(options.cache_bytes, options.spill_dir), stopping(false), errors(0) {
+        if(!options.spill_dir.empty()) mkdir(options.spill_dir.c_str(), 0755);
+        int thread_count = std::max(1, options.thread_count);
+        for (int i = 0; i < thread_count; ++i) {
+            workers.push_back(std::thread([this]() { work(); }));
+        }
+    }
+
+    ~RetimingService() {
+        stop();
+    }
+
+    void submit(ServiceRequest request) {
+        request.submitted = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(request));
+        }
+        ready.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(stopping) return;
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread &worker: workers) {
+            worker.join();
+        }
+    }
+
+    void work() {
+        BatchScratch scratch;
+        while(true) {
+            ServiceRequest request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if(queue.empty()) return;
+                request = std::move(queue.front());
+                queue.pop_front();
+            }
+            ServiceResponse response = run(request, scratch);
+            response.latency = batch_milliseconds(request.submitted);
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                latencies.push_back(response.latency);
+                if(!response.r) ++errors;
+            }
+            if(request.respond) request.respond(response);
+        }
+    }
+
+    //Runs the request, an allocation failure being answered as an error instead of ending the worker
+    ServiceResponse run(ServiceRequest &request, BatchScratch &scratch) {
+        ServiceResponse response = {};
+        response.id = request.id;
+        response.algorithm = request.algorithm;
+        response.c = -1;
+        try {
+            run_request(request, scratch, response);
+        } catch(std::bad_alloc &) {
+            response.r = false;
+            response.error = "out of memory";
+        }
+        return response;
+    }
+
+    void run_request(ServiceRequest &request, BatchScratch &scratch, ServiceResponse &response) {
+        Graph graph;
+        if(!graph_from_buffer(request.data.data(), request.data.size(), &graph)) {
+            response.error = "not a graph file";
+            return;
+        }
+        if(graph.vertex_count == 0) {
+            response.error = "empty circuit";
+            return;
+        }
+        batch_copy_graph(graph, scratch);
+        int vertex_count = graph.vertex_count;
+        CircuitView view = { scratch.delays.data(), vertex_count, scratch.from.data(), scratch.to.data(), scratch.weight.data(), graph.edge_count };
+        ViewIndex index(view);
+        scratch.r.assign(vertex_count, 0);
+        scratch.deltas.resize(vertex_count);
+        if(view_cp(view, index, nullptr, scratch.deltas.data()) < 0) {
+            response.error = batch_zero_weight_cycle_error(view, scratch);
+            return;
+        }
+
+        //WD and candidates, from the cache or computed and cached
+        std::shared_ptr<WDCacheEntry> entry;
+        if(request.algorithm != SERVICE_FEAS) {
+            if((size_t) vertex_count * vertex_count > options.cache_bytes / sizeof(WDEntry)) {
+                response.error = "WD matrix does not fit in memory";
+                return;
+            }
+            uint64_t hash = circuit_hash(view);
+            entry = cache.find(hash, view, &response.wd_source);
+            try {
+                if(!entry) {
+                    entry = std::make_shared<WDCacheEntry>();
+                    entry->hash = hash;
+                    entry->delays = scratch.delays;
+                    entry->from = scratch.from;
+                    entry->to = scratch.to;
+                    entry->weight = scratch.weight;
+                    entry->WD.resize((size_t) vertex_count * vertex_count);
+                    view_wd(view, entry->WD.data());
+                    entry->candidates = view_c_candidates(view, entry->WD.data(), view_period_lower_bound(view));
+                }
+                cache.insert(entry);
+            } catch(...) {
+                //unless it was a hit, this worker holds the circuit as pending
+                if(response.wd_source != WD_HIT) cache.abandon(hash);
+                throw;
+            }
+        }
+
+        ViewResult result = {false, -1};
+        if(request.algorithm == SERVICE_AUTO) {
+            response.algorithm = choose_batch_algorithm(view) == BATCH_OPT1 ? SERVICE_OPT1 : SERVICE_OPT2;
+        }
+        switch(response.algorithm) {
+            case SERVICE_OPT1:
+                result = view_opt1(view, entry->WD.data(), entry->candidates, scratch.r.data());
+                break;
+            case SERVICE_OPT2:
+                result = view_opt2(view, entry->candidates, scratch.r.data());
+                break;
+            case SERVICE_FEAS:
+                result = view_feas(view, index, request.target_c, scratch.r.data(), scratch.deltas.data());
+                break;
+            default: {
+                OptResult area_result = min_area(graph, entry->WD.data(), request.target_c);
+                result = {area_result.r, request.target_c};
+                if(area_result.r) {
+                    for (int v = 0; v < vertex_count; ++v) {
+                        scratch.r[v] = area_result.graph.vertices[v].weight;
+                    }
+                    free(area_result.graph.vertices);
+                    free(area_result.graph.edges);
+                }
+                break;
+            }
+        }
+        if(!result.r) {
+            response.error = "no retiming found";
+            return;
+        }
+
+        //verify: no negative edge and the period of the retimed circuit
+        for (int e = 0; e < view.edge_count; ++e) {
+            if(view_retimed_weight(view, scratch.r.data(), e) < 0) {
+                response.error = "illegal retiming";
+                return;
+            }
+        }
+        response.c = view_cp(view, index, scratch.r.data(), scratch.deltas.data());
+        if(response.c < 0 || response.c > result.c) {
+            response.error = "illegal retiming";
+            return;
+        }
+
+#ifdef SERVICEDEBUG
+        printf("[Service] %s: %s c = %d, WD %s\n", request.id.c_str(), service_algorithm_names[response.algorithm], response.c,
+                wd_source_names[response.wd_source]);
+#endif
+
+        response.r = true;
+        response.retiming = scratch.r;
+    }
+
+    //Latency percentiles of the answered requests and cache counters
+    ServiceStats get_stats() {
+        ServiceStats stats = {};
+        std::vector<double> sorted;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            sorted = latencies;
+            stats.errors = errors;
+        }
+        stats.requests = sorted.size();
+        if(!sorted.empty()) {
+            std::sort(sorted.begin(), sorted.end());
+            auto percentile = [&](double p) { return sorted[std::min(sorted.size()-1, (size_t) (p * sorted.size()))]; };
+            stats.p50 = percentile(0.5);
+            stats.p90 = percentile(0.9);
+            stats.p99 = percentile(0.99);
+            stats.max = sorted.back();
+            for (double latency: sorted) {
+                stats.mean += latency;
+            }
+            stats.mean /= sorted.size();
+        }
+        stats.cache = cache.get_stats();
+        return stats;
+    }
+};
+
+//One line summary of the stats
+std::string format_service_stats(ServiceStats stats) {
+    char line[512];
+    snprintf(line, sizeof(line), "requests %lld errors %lld latency_ms p50 %.3f p90 %.3f p99 %.3f max %.3f mean %.3f "
+            "cache hits %lld spill_hits %lld misses %lld evictions %lld spills %lld entries %zu bytes %zu",
+            stats.requests, stats.errors, stats.p50, stats.p90, stats.p99, stats.max, stats.mean, stats.cache.hits,
+            stats.cache.spill_hits, stats.cache.misses, stats.cache.evictions, stats.cache.spills, stats.cache.entries, stats.cache.bytes);
+    return line;
+}
+
+//Buffered reads of lines and blocks from a file descriptor
+struct FdReader {
+    int fd;
+    std::vector<char> buffer;
+    size_t begin, end;
+
+    FdReader(int fd): fd(fd), buffer(1 << 16), begin(0), end(0) {}
+
+    bool fill() {
+        begin = 0;
+        ssize_t size;
+        do {
+            size = read(fd, buffer.data(), buffer.size());
+        } while(size < 0 && errno == EINTR);
+        end = size > 0 ? size : 0;
+        return size > 0;
+    }
+
+    //Line without its '\n', false at the end of the input
+    bool read_line(std::string &line) {
+        line.clear();
+        while(true) {
+            if(begin == end && !fill()) return !line.empty();
+            char *first = buffer.data() + begin;
+            char *newline = (char *) memchr(first, '\n', end - begin);
+            if(newline) {
+                line.append(first, newline - first);
+                begin += newline - first + 1;
+                return true;
+            }
+            line.append(first, end - begin);
+            begin = end;
+        }
+    }
+
+    bool read_bytes(char *data, size_t size) {
+        while(size > 0) {
+            if(begin == end && !fill()) return false;
+            size_t count = std::min(size, end - begin);
+            memcpy(data, buffer.data() + begin, count);
+            begin += count;
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+};
+
+//Where the responses of a connection go, closed when the last pending response is written
+struct ServiceConnection {
+    int fd;
+    bool owns_fd;
+    std::mutex mutex;
+
+    ServiceConnection(int fd, bool owns_fd): fd(fd), owns_fd(owns_fd) {}
+
+    ~ServiceConnection() {
+        if(owns_fd) close(fd);
+    }
+
+    void write_all(const std::string &text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const char *data = text.data();
+        size_t size = text.size();
+        while(size > 0) {
+            ssize_t written = write(fd, data, size);
+            if(written < 0 && errno == EINTR) continue;
+            if(written <= 0) return;
+            data += written;
+            size -= written;
+        }
+    }
+};
+
+std::string format_service_response(ServiceResponse &response) {
+    if(!response.r) return response.id + " error " + response.error + "\n";
+    char header[256];
+    snprintf(header, sizeof(header), " ok %s %d %s %.3f %d", service_algorithm_names[response.algorithm], response.c,
+            wd_source_names[response.wd_source], response.latency, (int) response.retiming.size());
+    std::string line = response.id + header;
+    for (int r: response.retiming) {
+        line += ' ';
+        line += std::to_string(r);
+    }
+    line += '\n';
+    return line;
+}
+
+/**
+ * Reads the requests of a connection (see PROTOCOL) and submits them to the service, answering through out.
+ * Returns when the input ends, on "quit" or "shutdown", or on a malformed request (answered with "- error ...").
+ * Returns true if the server was asked to shut down.
+ */
+bool serve_connection(RetimingService &service, int in_fd, std::shared_ptr<ServiceConnection> out) {
+    FdReader reader(in_fd);
+    std::string line;
+    while(reader.read_line(line)) {
+        if(line.empty()) continue;
+        if(line == "quit") return false;
+        if(line == "shutdown") return true;
+        if(line == "stats") {
+            out->write_all("stats " + format_service_stats(service.get_stats()) + "\n");
+            continue;
+        }
+
+        char id[128];
+        char algorithm[32];
+        int target_c;
+        long long bytes;
+        if(sscanf(line.c_str(), "%127s %31s %d %lld", id, algorithm, &target_c, &bytes) != 4 || bytes < 0) {
+            out->write_all("- error bad request\n");
+            return false;
+        }
+        ServiceRequest request;
+        request.id = id;
+        request.target_c = target_c;
+        request.algorithm = (ServiceAlgorithm) -1;
+        for (int a = 0; a < service_algorithm_count; ++a) {
+            if(strcmp(algorithm, service_algorithm_names[a]) == 0) request.algorithm = (ServiceAlgorithm) a;
+        }
+        if((unsigned long long) bytes > service.options.max_request_bytes) {
+            out->write_all(request.id + " error request too large\n");
+            return false;
+        }
+        request.data.resize(bytes);
+        if(!reader.read_bytes(request.data.data(), bytes)) {
+            out->write_all(request.id + " error truncated request\n");
+            return false;
+        }
+        if(request.algorithm < 0) {
+            out->write_all(request.id + " error unknown algorithm " + algorithm + "\n");
+            continue;
+        }
+        request.respond = [out](ServiceResponse &response) { out->write_all(format_service_response(response)); };
+        service.submit(std::move(request));
+    }
+    return false;
+}
+
+/**
+ * Serves the connections to a Unix domain socket at path, one reader thread each, until one of them sends "shutdown".
+ * Returns false if the socket could not be created.
+ */
+bool run_socket_server(RetimingService &service, std::string path) {
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listen_fd < 0) return false;
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)) {
+        close(listen_fd);
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if(bind(listen_fd, (sockaddr *) &address, sizeof(address)) != 0 || listen(listen_fd, 64) != 0) {
+        close(listen_fd);
+        return false;
+    }
+
+    std::atomic<bool> shutting_down(false);
+    std::mutex clients_mutex;
+    std::unordered_set<int> client_fds; //connections still being read, their fd still open
+    std::unordered_map<long long, std::thread> readers;
+    std::vector<long long> finished; //readers done, joined on the next accept
+    long long connection_count = 0;
+    while(true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if(fd < 0) {
+            if(errno == EINTR && !shutting_down) continue;
+            break;
+        }
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (long long id: finished) {
+            readers[id].join();
+            readers.erase(id);
+        }
+        finished.clear();
+        if(shutting_down) {
+            close(fd);
+            break;
+        }
+        client_fds.insert(fd);
+        long long id = connection_count++;
+        readers[id] = std::thread([&, fd, id]() {
+            bool shutdown_requested;
+            {
+                std::shared_ptr<ServiceConnection> out = std::make_shared<ServiceConnection>(fd, true);
+                shutdown_requested = serve_connection(service, fd, out);
+                //the fd is closed with the last response, maybe later: it leaves the set while this reader keeps it
+                //open, so a new connection given the same fd is never shut down in its place
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                client_fds.erase(fd);
+            }
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            if(shutdown_requested) {
+                shutting_down = true;
+                //wakes up accept and the other readers
+                shutdown(listen_fd, SHUT_RDWR);
+                for (int client_fd: client_fds) {
+                    shutdown(client_fd, SHUT_RD);
+                }
+            }
+            finished.push_back(id);
+        });
+    }
+    for (auto &reader: readers) {
+        reader.second.join();
+    }
+    close(listen_fd);
+    unlink(path.c_str());
+    return true;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string>
+#include "service.cpp"
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-j threads] [-m cache_MB] [-d spill_dir] [-r max_request_MB] [-s socket_path]\n"
+            "  -j  worker threads (default: hardware threads)\n"
+            "  -m  memory for cached WD matrices and candidates, in MB (default: 1024)\n"
+            "  -d  directory where evicted WD matrices are spilled and read back from\n"
+            "  -r  biggest graph file accepted in a request, in MB (default: 1024)\n"
+            "  -s  serve a Unix domain socket instead of stdin/stdout, until a client sends shutdown\n"
+            "Requests and responses are described in service.cpp. Latency percentiles and cache counters are printed\n"
+            "to stderr when the service stops.\n", program);
+}
+
+int main(int argc, char **argv) {
+    ServiceOptions options;
+    std::string socket_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i+1 < argc;
+        if(arg == "-j" && has_value) {
+            options.thread_count = atoi(argv[++i]);
+        } else if(arg == "-m" && has_value) {
+            options.cache_bytes = (size_t) atoll(argv[++i]) << 20;
+        } else if(arg == "-d" && has_value) {
+            options.spill_dir = argv[++i];
+        } else if(arg == "-r" && has_value) {
+            options.max_request_bytes = (size_t) atoll(argv[++i]) << 20;
+        } else if(arg == "-s" && has_value) {
+            socket_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    //a client going away must not kill the service
+    signal(SIGPIPE, SIG_IGN);
+
+    RetimingService service(options);
+    if(socket_path.empty()) {
+        serve_connection(service, 0, std::make_shared<ServiceConnection>(1, false));
+    } else if(!run_socket_server(service, socket_path)) {
+        fprintf(stderr, "Could not listen on %s\n", socket_path.c_str());
+        return 1;
+    }
+    service.stop();
+
+    fprintf(stderr, "%s\n", format_service_stats(service.get_stats()).c_str());
+    return 0;
+}
@@ -1,3 +1,6 @@
+#ifndef SPACEBENCHH
+#define SPACEBENCHH
+
 #include <iostream>
 #include <vector>
 #include <assert.h>
@@ -34,7 +37,7 @@ struct Allocation {
 struct SpaceBench {
     std::vector<Allocation> stack_allocations;
     std::vector<Allocation> heap_allocations;
-    int stack_bases[10];
+    int stack_bases[10] = {};
     int current_stack = -1;
 
     size_t heap_size = 0;
@@ -120,6 +123,4 @@ struct SpaceBench {
     }
 };
 
-//global SpaceBench for the current benchmark, probably not the best idea, but no need to complicate things
-SpaceBench *space_bench; 
-
+#endif
@@ -1,8 +1,5 @@
 //#define DEBUGSPACEBENCH
 
-#define SPACEBENCH
-#include "space_bench.cpp"
-
 #include <iostream>
 #include <math.h>
 #include "cp.cpp"
@@ -11,6 +8,7 @@
 #include "feas.cpp"
 #include "circuit_generator.cpp" 
 #include "types.h"
+#include "instrument.cpp"
 
 const int graph_count = 12;
 
@@ -36,11 +34,10 @@ Graph graphs[] = {
  */
 void SBM_cp() {
     double N = 0;
-    SpaceBench benchmarks[graph_count];
 
     printf("CP Benchmark:\n");
     for(int i = 0; i < graph_count; ++i) {
-        space_bench = &benchmarks[i];
+        SpaceBench *space_bench = SpaceInstrument::reset();
         Graph graph = graphs[i];
         printf("cp/%d\tvertices: %d, edges: %d\n", i, graph.vertex_count, graph.edge_count);
         space_bench->push_stack();
@@ -50,7 +47,7 @@ void SBM_cp() {
         int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
         space_bench->allocated(sizeof(int) * graph.vertex_count, true, INT, "deltas");
 
-        cp(graph, deltas);
+        cp<SpaceInstrument>(graph, deltas);
 
         free(deltas);
 
@@ -74,11 +71,10 @@ void SBM_cp() {
  */
 void SBM_wd() {
     double N = 0;
-    SpaceBench benchmarks[graph_count];
 
     printf("WD Benchmark:\n");
     for(int i = 0; i < graph_count; ++i) {
-        space_bench = &benchmarks[i];
+        SpaceBench *space_bench = SpaceInstrument::reset();
         Graph graph = graphs[i];
         printf("wd/%d\tvertices: %d, edges: %d\n", i, graph.vertex_count, graph.edge_count);
         space_bench->push_stack();
@@ -86,7 +82,7 @@ void SBM_wd() {
         space_bench->allocated(sizeof(Edge) * graph.edge_count, true, EDGE);
 
 
-        WDEntry *WD = wd(graph);
+        WDEntry *WD = wd<SpaceInstrument>(graph);
 
         free(WD);
 
@@ -110,19 +106,18 @@ void SBM_wd() {
  */
 void SBM_opt1() {
     double N = 0;
-    SpaceBench benchmarks[graph_count];
 
     printf("OPT1 Benchmark:\n");
     for(int i = 0; i < graph_count; ++i) {
-        space_bench = &benchmarks[i];
+        SpaceBench *space_bench = SpaceInstrument::reset();
         Graph graph = graphs[i];
         printf("opt1/%d\tvertices: %d, edges: %d\n", i, graph.vertex_count, graph.edge_count);
         space_bench->push_stack();
         space_bench->allocated(sizeof(Vertex) * graph.vertex_count, true, VERTEX);
         space_bench->allocated(sizeof(Edge) * graph.edge_count, true, EDGE);
 
-        WDEntry *WD = wd(graph);
-        OptResult result = opt1(graph, WD);
+        WDEntry *WD = wd<SpaceInstrument>(graph);
+        OptResult result = opt1<SpaceInstrument>(graph, WD);
 
         free(WD);
         space_bench->deallocated(sizeof(WDEntry) * pow(graph.vertex_count, 2), INT);
@@ -150,11 +145,10 @@ void SBM_opt1() {
  */
 void SBM_feas() {
     double N = 0;
-    SpaceBench benchmarks[graph_count];
 
     printf("FEAS Benchmark:\n");
     for(int i = 0; i < graph_count; ++i) {
-        space_bench = &benchmarks[i];
+        SpaceBench *space_bench = SpaceInstrument::reset();
         Graph graph = graphs[i];
 
         int *deltas = (int *) malloc(sizeof(int) * graph.vertex_count);
@@ -166,7 +160,7 @@ void SBM_feas() {
         space_bench->allocated(sizeof(Vertex) * graph.vertex_count, true, VERTEX);
         space_bench->allocated(sizeof(Edge) * graph.edge_count, true, EDGE);
 
-        FeasResult result = feas(graph, target_c, deltas);
+        FeasResult result = feas<SpaceInstrument>(graph, target_c, deltas);
 
 
         free(deltas);
@@ -197,19 +191,18 @@ void SBM_feas() {
  */
 void SBM_opt2() {
     double N = 0;
-    SpaceBench benchmarks[graph_count];
 
     printf("OPT2 Benchmark:\n");
     for(int i = 0; i < graph_count; ++i) {
-        space_bench = &benchmarks[i];
+        SpaceBench *space_bench = SpaceInstrument::reset();
         Graph graph = graphs[i];
         printf("opt2/%d\tvertices: %d, edges: %d\n", i, graph.vertex_count, graph.edge_count);
         space_bench->push_stack();
         space_bench->allocated(sizeof(Vertex) * graph.vertex_count, true, VERTEX);
         space_bench->allocated(sizeof(Edge) * graph.edge_count, true, EDGE);
 
-        WDEntry *WD = wd(graph);
-        OptResult result = opt2(graph, WD);
+        WDEntry *WD = wd<SpaceInstrument>(graph);
+        OptResult result = opt2<SpaceInstrument>(graph, WD);
 
         free(WD);
         space_bench->deallocated(sizeof(WDEntry) * pow(graph.vertex_count, 2), INT);
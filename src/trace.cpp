@@ -0,0 +1,141 @@
+#ifndef TRACER
+#define TRACER
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+/**
+ * Trace of the retiming pipeline: inclusive time and calls of each instrumented algorithm (phase), counters, and a
+ * trace of the binary search probes of OPT1 and OPT2. It is recorded by running the algorithms with the TraceInstrument
+ * policy (see instrument.cpp); with any other policy the algorithms do not touch it.
+ * Phase times are inclusive (CP time is also part of FEAS time) and, like the counters and the probes, accumulate in
+ * the trace of the calling thread until reset_trace.
+ */
+
+enum TraceCounter {
+    TRACE_PROBES,
+    TRACE_FEASIBLE,
+    TRACE_INFEASIBLE,
+    TRACE_CONSTRAINT_EDGES, //7.2 edges added
+    TRACE_BELLMAN_RELAXATIONS,
+    TRACE_FEAS_ITERATIONS,
+    TRACE_CP_CALLS,
+    TRACE_COUNTER_COUNT
+};
+
+const char *trace_counter_names[] = { "probes", "feasible", "infeasible", "constraint_edges", "bellman_relaxations", "feas_iterations", "cp_calls" };
+
+//One step of the binary search, counters are the ones of the step
+struct TraceProbe {
+    const char *algorithm;
+    int b;
+    int bot;
+    int top;
+    int c; //probed candidate
+    bool feasible;
+    int result_c; //clock period found (FEAS may go below c), -1 if not feasible
+    double time; //ms
+    long long counters[TRACE_COUNTER_COUNT];
+};
+
+struct TracePhase {
+    const char *name; //as given to Instrument::enter
+    double time; //ms, inclusive of the instrumented algorithms it calls
+    long long calls;
+};
+
+struct Trace {
+    std::vector<TracePhase> phases; //in order of first call
+    long long counters[TRACE_COUNTER_COUNT];
+    std::vector<TraceProbe> probes;
+};
+
+thread_local Trace retiming_trace = {};
+
+void reset_trace() {
+    retiming_trace = {};
+}
+
+//Start of a probe: time and counters, to record what the probe itself did
+struct TraceProbeStart {
+    std::chrono::steady_clock::time_point begin;
+    long long counters[TRACE_COUNTER_COUNT];
+
+    TraceProbeStart(): begin(std::chrono::steady_clock::now()) {
+        for (int i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+            counters[i] = retiming_trace.counters[i];
+        }
+    }
+
+    void record(const char *algorithm, int b, int bot, int top, int c, bool feasible, int result_c) {
+        ++retiming_trace.counters[TRACE_PROBES];
+        ++retiming_trace.counters[feasible ? TRACE_FEASIBLE : TRACE_INFEASIBLE];
+        TraceProbe probe = { algorithm, b, bot, top, c, feasible, feasible ? result_c : -1,
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(), {} };
+        for (int i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+            probe.counters[i] = retiming_trace.counters[i] - counters[i];
+        }
+        retiming_trace.probes.push_back(probe);
+    }
+};
+
+/**
+ * Writes the trace of the calling thread as JSON: phases (time in ms and calls), counters and probes.
+ * Returns true if the file was written.
+ */
+bool write_trace_json(std::string path) {
+    FILE *file = fopen(path.c_str(), "w");
+    if(!file) return false;
+    Trace &trace = retiming_trace;
+
+    fprintf(file, "{\n  \"phases\": {");
+    for (size_t i = 0; i < trace.phases.size(); ++i) {
+        fprintf(file, "%s\n    \"%s\": {\"time_ms\": %.6f, \"calls\": %lld}", i ? "," : "", trace.phases[i].name, trace.phases[i].time,
+                trace.phases[i].calls);
+    }
+    fprintf(file, "\n  },\n  \"counters\": {");
+    for (int i = 0; i < TRACE_COUNTER_COUNT; ++i) {
+        fprintf(file, "%s\n    \"%s\": %lld", i ? "," : "", trace_counter_names[i], trace.counters[i]);
+    }
+    fprintf(file, "\n  },\n  \"probes\": [");
+    for (size_t p = 0; p < trace.probes.size(); ++p) {
+        TraceProbe &probe = trace.probes[p];
+        fprintf(file, "%s\n    {\"algorithm\": \"%s\", \"b\": %d, \"bot\": %d, \"top\": %d, \"c\": %d, \"feasible\": %s, \"result_c\": %d, \"time_ms\": %.6f",
+                p ? "," : "", probe.algorithm, probe.b, probe.bot, probe.top, probe.c, probe.feasible ? "true" : "false", probe.result_c, probe.time);
+        for (int i = TRACE_CONSTRAINT_EDGES; i < TRACE_COUNTER_COUNT; ++i) {
+            fprintf(file, ", \"%s\": %lld", trace_counter_names[i], probe.counters[i]);
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    return fclose(file) == 0;
+}
+
+/**
+ * Writes the probes of the trace of the calling thread as CSV, one line per probe.
+ * Returns true if the file was written.
+ */
+bool write_trace_csv(std::string path) {
+    FILE *file = fopen(path.c_str(), "w");
+    if(!file) return false;
+
+    fprintf(file, "algorithm,b,bot,top,c,feasible,result_c,time_ms");
+    for (int i = TRACE_CONSTRAINT_EDGES; i < TRACE_COUNTER_COUNT; ++i) {
+        fprintf(file, ",%s", trace_counter_names[i]);
+    }
+    fprintf(file, "\n");
+    for (TraceProbe &probe: retiming_trace.probes) {
+        fprintf(file, "%s,%d,%d,%d,%d,%d,%d,%.6f", probe.algorithm, probe.b, probe.bot, probe.top, probe.c, probe.feasible, probe.result_c, probe.time);
+        for (int i = TRACE_CONSTRAINT_EDGES; i < TRACE_COUNTER_COUNT; ++i) {
+            fprintf(file, ",%lld", probe.counters[i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    return fclose(file) == 0;
+}
+
+#endif
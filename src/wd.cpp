@@ -4,7 +4,11 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/johnson_all_pairs_shortest.hpp>
 #include <vector>
+#include <set>
+#include <algorithm>
 #include "types.h"
+#include "trace.cpp"
+#include "instrument.cpp"
 
 //define WDDEBUG
 
@@ -52,10 +56,9 @@ struct WDEdgeWeight {
  * The edges built into the graph are weighted according to the WD algorithm requirements.
  * Returns a WDEntry matrix.
  */
+template<typename Instrument = NoInstrument>
 WDEntry *wd(Graph &graph) {
-#ifdef SPACEBENCH
-    space_bench->push_stack();
-#endif
+    Instrument::enter("wd");
     using namespace boost;
     //typedef the graph
     typedef adjacency_list<vecS, vecS, directedS, no_property, property<edge_weight_t, WDEdgeWeight, property<edge_weight2_t, WDEdgeWeight>>> BGLGraph;
@@ -69,10 +72,12 @@ WDEntry *wd(Graph &graph) {
     BGLGraph g(vertex_count);
 
     //add edges
+    Instrument::enter("wd graph");
     for(int i = 0; i < edge_count; ++i) {
         int from = edges[i].from;
         add_edge(from, edges[i].to, WDEdgeWeight((edges[i].weight), -vertices[from].weight), g);
     }
+    Instrument::leave();
 
     int maxweight = std::numeric_limits<int>::max();
     WDEdgeWeight max = WDEdgeWeight(maxweight, maxweight);
@@ -81,18 +86,20 @@ WDEntry *wd(Graph &graph) {
     std::vector<std::vector<WDEdgeWeight>> D(vertex_count, std::vector<WDEdgeWeight>(vertex_count));
 
     //call johnson all shortest paths
-    johnson_all_pairs_shortest_paths(g, D, distance_inf(max).distance_zero(WDEdgeWeight(0, 0)));
+    //the combine function needs the explicit infinity, the default one comes from numeric_limits, which is undefined for WDEdgeWeight
+    Instrument::enter("johnson");
+    johnson_all_pairs_shortest_paths(g, D, distance_inf(max).distance_zero(WDEdgeWeight(0, 0)).distance_combine(closed_plus<WDEdgeWeight>(max)));
+    Instrument::leave();
 
     //compute result into a WDEntry matrix
     int size = vertex_count * vertex_count;
     WDEntry* WD = (WDEntry*) malloc(sizeof(WDEntry) * size);
 
-#ifdef SPACEBENCH
-    space_bench->allocated(sizeof(int) * graph.vertex_count, false, BGLVERTEX, "BGL graph vertices");
-    space_bench->allocated(sizeof(int) * 2 * graph.edge_count, false, BGLEDGE, "BGL graph edges");
-    space_bench->allocated(sizeof(WDEntry) * graph.vertex_count * graph.vertex_count, true, INT, "WD matrix");
-#endif
+    Instrument::allocated(sizeof(int) * graph.vertex_count, false, BGLVERTEX, "BGL graph vertices");
+    Instrument::allocated(sizeof(int) * 2 * graph.edge_count, false, BGLEDGE, "BGL graph edges");
+    Instrument::allocated(sizeof(WDEntry) * graph.vertex_count * graph.vertex_count, true, INT, "WD matrix");
 
+    Instrument::enter("wd matrix");
     for (int i = 0; i < vertex_count; ++i) { 
         for (int j = 0; j < vertex_count; ++j) {
             WDEntry* entry = &WD[i * vertex_count + j];
@@ -101,14 +108,47 @@ WDEntry *wd(Graph &graph) {
             //printf("%d,%d: %d\n", i, j , WD[i * vertex_count + j].W);
         }
     } 
+    Instrument::leave();
 
-#ifdef SPACEBENCH
-    space_bench->pop_stack();
-#endif
+    Instrument::leave();
 
     return WD;
 }
 
+/**
+ * Different D values >= lower_bound (and at least 1) of a WD matrix of size entries, in increasing order: the
+ * candidates for the minimized clock period, shared by get_c_candidates and view_c_candidates.
+ * D values are path delays, so they usually fit a bitmap of the values seen, O(size), and a set otherwise.
+ */
+template<typename Instrument = NoInstrument>
+std::vector<int> wd_c_candidates(WDEntry *WD, long long size, int lower_bound) {
+    lower_bound = std::max(lower_bound, 1);
+    int max_D = lower_bound - 1;
+    for (long long i = 0; i < size; ++i) {
+        if(WD[i].D >= lower_bound && WD[i].D < MAXINT && WD[i].D > max_D) max_D = WD[i].D;
+    }
+
+    std::vector<int> candidates;
+    if((long long) max_D - lower_bound < 4 * size + 1024) {
+        std::vector<bool> seen(max_D - lower_bound + 1, false);
+        for (long long i = 0; i < size; ++i) {
+            if(WD[i].D >= lower_bound && WD[i].D < MAXINT) seen[WD[i].D - lower_bound] = true;
+        }
+        for (int c = lower_bound; c <= max_D; ++c) {
+            if(seen[c - lower_bound]) candidates.push_back(c);
+        }
+        Instrument::allocated((max_D - lower_bound) / 8 + 1, false, INT, "c candidates bitmap");
+    } else {
+        std::set<int> candidates_set;
+        for (long long i = 0; i < size; ++i) {
+            if(WD[i].D >= lower_bound && WD[i].D < MAXINT) candidates_set.insert(WD[i].D);
+        }
+        candidates.assign(candidates_set.begin(), candidates_set.end());
+        Instrument::allocated(sizeof(int) * candidates.size(), false, INT, "c candidates set");
+    }
+    return candidates;
+}
+
 
 #ifdef WDDEBUG
 int main_wd() {